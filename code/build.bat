@@ -13,6 +13,7 @@ REM cl %CommonCompilerFlags% ..\handmade\code\win32_handmade.cpp /link -subsyste
 
 REM 64-bit build
 del *.pdb > NUL 2> NUL
+cl %CommonCompilerFlags% -D_CRT_SECURE_NO_WARNINGS ..\code\test_asset_builder.cpp /link %CommonLinkerFlags%
 REM Optimization switches /O2
 echo WAITING FOR PDB > lock.tmp
 cl %CommonCompilerFlags% ..\code\handmade.cpp -Fmhandmade.map -LD /link -incremental:no -opt:ref -PDB:handmade_%random%.pdb -EXPORT:GameGetSoundSamples -EXPORT:GameUpdateAndRender
@@ -7,6 +7,10 @@
    ======================================================================== */
 
 #include "handmade.h"
+#include "handmade_bitmap_spans.cpp"
+#include "handmade_bmp.cpp"
+#include "handmade_render_group.cpp"
+#include "handmade_asset.cpp"
 #include "handmade_world.cpp"
 #include "handmade_random.h"
 #include "handmade_sim_region.cpp"
@@ -43,245 +47,28 @@ GameOutputSound(game_state *GameState, game_sound_output_buffer *SoundBuffer, in
     }
 }
 
-internal void
-DrawRectangle(game_offscreen_buffer *Buffer, v2 vMin, v2 vMax, real32 R, real32 G, real32 B)
-{    
-    int32 MinX = RoundReal32ToInt32(vMin.X);
-    int32 MinY = RoundReal32ToInt32(vMin.Y);
-    int32 MaxX = RoundReal32ToInt32(vMax.X);
-    int32 MaxY = RoundReal32ToInt32(vMax.Y);
-
-    if(MinX < 0)
-    {
-        MinX = 0;
-    }
-
-    if(MinY < 0)
-    {
-        MinY = 0;
-    }
-
-    if(MaxX > Buffer->Width)
-    {
-        MaxX = Buffer->Width;
-    }
-
-    if(MaxY > Buffer->Height)
-    {
-        MaxY = Buffer->Height;
-    }
-
-    uint32 Color = ((RoundReal32ToUInt32(R * 255.0f) << 16) |
-                    (RoundReal32ToUInt32(G * 255.0f) << 8) |
-                    (RoundReal32ToUInt32(B * 255.0f) << 0));
-
-    uint8 *Row = ((uint8 *)Buffer->Memory +
-                  MinX*Buffer->BytesPerPixel +
-                  MinY*Buffer->Pitch);
-    for(int Y = MinY;
-        Y < MaxY;
-        ++Y)
-    {
-        uint32 *Pixel = (uint32 *)Row;
-        for(int X = MinX;
-            X < MaxX;
-            ++X)
-        {            
-            *Pixel++ = Color;
-        }
-        
-        Row += Buffer->Pitch;
-    }
-}
-
-internal void
-DrawBitmap(game_offscreen_buffer *Buffer, loaded_bitmap *Bitmap,
-           real32 RealX, real32 RealY, real32 CAlpha = 1.0f)
-{
-    int32 MinX = RoundReal32ToInt32(RealX);
-    int32 MinY = RoundReal32ToInt32(RealY);
-    int32 MaxX = MinX + Bitmap->Width;
-    int32 MaxY = MinY + Bitmap->Height;
-
-    int32 SourceOffsetX = 0;
-    if(MinX < 0)
-    {
-        SourceOffsetX = -MinX;
-        MinX = 0;
-    }
-
-    int32 SourceOffsetY = 0;
-    if(MinY < 0)
-    {
-        SourceOffsetY = -MinY;
-        MinY = 0;
-    }
-
-    if(MaxX > Buffer->Width)
-    {
-        MaxX = Buffer->Width;
-    }
-
-    if(MaxY > Buffer->Height)
-    {
-        MaxY = Buffer->Height;
-    }
-
-    // TODO(casey): SourceRow needs to be changed based on clipping.
-    uint32 *SourceRow = Bitmap->Pixels + Bitmap->Width*(Bitmap->Height - 1);
-    SourceRow += -SourceOffsetY*Bitmap->Width + SourceOffsetX;
-    uint8 *DestRow = ((uint8 *)Buffer->Memory +
-                      MinX*Buffer->BytesPerPixel +
-                      MinY*Buffer->Pitch);
-    for(int Y = MinY;
-        Y < MaxY;
-        ++Y)
-    {
-        uint32 *Dest = (uint32 *)DestRow;
-        uint32 *Source = SourceRow;
-        for(int X = MinX;
-            X < MaxX;
-            ++X)
-        {
-            real32 A = (real32)((*Source >> 24) & 0xFF) / 255.0f;
-            A *= CAlpha;
-            
-            real32 SR = (real32)((*Source >> 16) & 0xFF);
-            real32 SG = (real32)((*Source >> 8) & 0xFF);
-            real32 SB = (real32)((*Source >> 0) & 0xFF);
-
-            real32 DR = (real32)((*Dest >> 16) & 0xFF);
-            real32 DG = (real32)((*Dest >> 8) & 0xFF);
-            real32 DB = (real32)((*Dest >> 0) & 0xFF);
-
-            // TODO(casey): Someday, we need to talk about premultiplied alpha!
-            // (this is not premultiplied alpha)
-            real32 R = (1.0f-A)*DR + A*SR;
-            real32 G = (1.0f-A)*DG + A*SG;
-            real32 B = (1.0f-A)*DB + A*SB;
-
-            *Dest = (((uint32)(R + 0.5f) << 16) |
-                     ((uint32)(G + 0.5f) << 8) |
-                     ((uint32)(B + 0.5f) << 0));
-            
-            ++Dest;
-            ++Source;
-        }
-
-        DestRow += Buffer->Pitch;
-        SourceRow -= Bitmap->Width;
-    }
-}
-
-#pragma pack(push, 1)
-struct bitmap_header
-{
-    uint16 FileType;
-    uint32 FileSize;
-    uint16 Reserved1;
-    uint16 Reserved2;
-    uint32 BitmapOffset;
-    uint32 Size;
-    int32 Width;
-    int32 Height;
-    uint16 Planes;
-    uint16 BitsPerPixel;
-    uint32 Compression;
-    uint32 SizeOfBitmap;
-    int32 HorzResolution;
-    int32 VertResolution;
-    uint32 ColorsUsed;
-    uint32 ColorsImportant;
-
-    uint32 RedMask;
-    uint32 GreenMask;
-    uint32 BlueMask;
-};
-#pragma pack(pop)
-
-internal loaded_bitmap
-DEBUGLoadBMP(thread_context *Thread, debug_platform_read_entire_file *ReadEntireFile, char *FileName)
-{
-    loaded_bitmap Result = {};
-    
-    debug_read_file_result ReadResult = ReadEntireFile(Thread, FileName);    
-    if(ReadResult.ContentsSize != 0)
-    {
-        bitmap_header *Header = (bitmap_header *)ReadResult.Contents;
-        uint32 *Pixels = (uint32 *)((uint8 *)ReadResult.Contents + Header->BitmapOffset);
-        Result.Pixels = Pixels;
-        Result.Width = Header->Width;
-        Result.Height = Header->Height;
-
-        Assert(Header->Compression == 3);
-
-        // NOTE(casey): If you are using this generically for some reason,
-        // please remember that BMP files CAN GO IN EITHER DIRECTION and
-        // the height will be negative for top-down.
-        // (Also, there can be compression, etc., etc... DON'T think this
-        // is complete BMP loading code because it isn't!!)
-
-        // NOTE(casey): Byte order in memory is determined by the Header itself,
-        // so we have to read out the masks and convert the pixels ourselves.
-        uint32 RedMask = Header->RedMask;
-        uint32 GreenMask = Header->GreenMask;
-        uint32 BlueMask = Header->BlueMask;
-        uint32 AlphaMask = ~(RedMask | GreenMask | BlueMask);        
-        
-        bit_scan_result RedScan = FindLeastSignificantSetBit(RedMask);
-        bit_scan_result GreenScan = FindLeastSignificantSetBit(GreenMask);
-        bit_scan_result BlueScan = FindLeastSignificantSetBit(BlueMask);
-        bit_scan_result AlphaScan = FindLeastSignificantSetBit(AlphaMask);
-        
-        Assert(RedScan.Found);
-        Assert(GreenScan.Found);
-        Assert(BlueScan.Found);
-        Assert(AlphaScan.Found);
-
-        int32 RedShift = 16 - (int32)RedScan.Index;
-        int32 GreenShift = 8 - (int32)GreenScan.Index;
-        int32 BlueShift = 0 - (int32)BlueScan.Index;
-        int32 AlphaShift = 24 - (int32)AlphaScan.Index;
-        
-        uint32 *SourceDest = Pixels;
-        for(int32 Y = 0;
-            Y < Header->Height;
-            ++Y)
-        {
-            for(int32 X = 0;
-                X < Header->Width;
-                ++X)
-            {
-                uint32 C = *SourceDest;
-
-                *SourceDest++ = (RotateLeft(C & RedMask, RedShift) |
-                                 RotateLeft(C & GreenMask, GreenShift) |
-                                 RotateLeft(C & BlueMask, BlueShift) |
-                                 RotateLeft(C & AlphaMask, AlphaShift));
-            }
-        }
-    }
-
-    return(Result);
-}
-
 struct add_low_entity_result
 {
     low_entity *Low;
     uint32 LowIndex;
 };
 internal add_low_entity_result
-AddLowEntity(game_state *GameState, entity_type Type, world_position P)
+AddLowEntity(game_state *GameState, entity_type Type, world_position P, v3 Dim)
 {
     Assert(GameState->LowEntityCount < ArrayCount(GameState->LowEntities));
     uint32 EntityIndex = GameState->LowEntityCount++;
    
-    low_entity *EntityLow = GameState->LowEntities + EntityIndex;
+    low_entity *EntityLow = AllocateLowEntity(&GameState->WorldArena, GameState->World);
+    GameState->LowEntities[EntityIndex] = EntityLow;
     *EntityLow = {};
     EntityLow->Sim.Type = Type;
+    // NOTE(casey): Dim has to be in before the entity goes into a chunk,
+    // since the chunk keeps its own copy for culling
+    EntityLow->Sim.Dim = Dim;
     EntityLow->P = NullPosition();
 
-    ChangeEntityLocation(&GameState->WorldArena, GameState->World, EntityIndex, EntityLow, P);
+    ChangeEntityLocation(&GameState->WorldArena, GameState->World, GameState->LowEntities,
+                         EntityIndex, P);
 
     add_low_entity_result Result;
     Result.Low = EntityLow;
@@ -298,10 +85,10 @@ internal add_low_entity_result
 AddWall(game_state *GameState, uint32 AbsTileX, uint32 AbsTileY, uint32 AbsTileZ)
 {
     world_position P = ChunkPositionFromTilePosition(GameState->World, AbsTileX, AbsTileY, AbsTileZ);
-    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Wall, P);
+    real32 TileSide = GameState->World->TileSideInMeters;
+    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Wall, P,
+                                                V3(TileSide, TileSide, 0.0f));
     
-    Entity.Low->Sim.Dim.Y = GameState->World->TileSideInMeters;
-    Entity.Low->Sim.Dim.X = Entity.Low->Sim.Dim.Y;
     AddFlags(&Entity.Low->Sim, EntityFlag_Collides);
 
     return(Entity);
@@ -314,12 +101,11 @@ AddStair(game_state *GameState, uint32 AbsTileX, uint32 AbsTileY, uint32 AbsTile
 		GameState->World, AbsTileX, AbsTileY, AbsTileZ,
 		V3(0.0f, 0.0f, 0.5f*GameState->World->TileDepthInMeters)
 	);
-    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Stairwell, P);
-    
-    Entity.Low->Sim.Dim.Y = GameState->World->TileSideInMeters;
-    Entity.Low->Sim.Dim.X = Entity.Low->Sim.Dim.Y;
+    real32 TileSide = GameState->World->TileSideInMeters;
 	// TODO: This is extremely not cool, figure out a better ground update solution
-    Entity.Low->Sim.Dim.Z = 1.2f*GameState->World->TileDepthInMeters;
+    real32 StairHeight = 1.2f*GameState->World->TileDepthInMeters;
+    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Stairwell, P,
+                                                V3(TileSide, TileSide, StairHeight));
 
     return(Entity);
 }
@@ -342,12 +128,10 @@ InitHitPoints(low_entity *EntityLow, uint32 HitPointCount)
 internal add_low_entity_result
 AddSword(game_state *GameState)
 {
-    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Sword, NullPosition());
+    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Sword, NullPosition(),
+                                                V3(1.0f, 0.5f, 0.0f));
 	AddFlags(&Entity.Low->Sim, EntityFlag_Moveable);
 
-    Entity.Low->Sim.Dim.Y = 0.5f;
-    Entity.Low->Sim.Dim.X = 1.0f;
-
     return(Entity);
 }
 
@@ -355,10 +139,9 @@ internal add_low_entity_result
 AddPlayer(game_state *GameState)
 {
     world_position P = GameState->CameraP;
-    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Hero, P);
+    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Hero, P,
+                                                V3(1.0f, 0.5f, 0.0f));
     
-    Entity.Low->Sim.Dim.Y = 0.5f; // 1.4f;
-    Entity.Low->Sim.Dim.X = 1.0f;
 	AddFlags(&Entity.Low->Sim, EntityFlag_Collides | EntityFlag_Moveable);
 
     InitHitPoints(Entity.Low, 3);
@@ -378,10 +161,9 @@ internal add_low_entity_result
 AddMonstar(game_state *GameState, uint32 AbsTileX, uint32 AbsTileY, uint32 AbsTileZ)
 {
     world_position P = ChunkPositionFromTilePosition(GameState->World, AbsTileX, AbsTileY, AbsTileZ);
-    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Monstar, P);
+    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Monstar, P,
+                                                V3(1.0f, 0.5f, 0.0f));
 
-    Entity.Low->Sim.Dim.Y = 0.5f;
-    Entity.Low->Sim.Dim.X = 1.0f;
     AddFlags(&Entity.Low->Sim, EntityFlag_Collides | EntityFlag_Moveable);
 
     InitHitPoints(Entity.Low, 3);
@@ -393,48 +175,16 @@ internal add_low_entity_result
 AddFamiliar(game_state *GameState, uint32 AbsTileX, uint32 AbsTileY, uint32 AbsTileZ)
 {
     world_position P = ChunkPositionFromTilePosition(GameState->World, AbsTileX, AbsTileY, AbsTileZ);
-    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Familiar, P);
+    add_low_entity_result Entity = AddLowEntity(GameState, EntityType_Familiar, P,
+                                                V3(1.0f, 0.5f, 0.0f));
 
-    Entity.Low->Sim.Dim.Y = 0.5f;
-    Entity.Low->Sim.Dim.X = 1.0f;
 	AddFlags(&Entity.Low->Sim, EntityFlag_Collides | EntityFlag_Moveable);
 
     return(Entity);
 }
 
-inline void
-PushPiece(entity_visible_piece_group *Group, loaded_bitmap *Bitmap,
-          v2 Offset, real32 OffsetZ, v2 Align, v2 Dim, v4 Color, real32 EntityZC)
-{
-    Assert(Group->PieceCount < ArrayCount(Group->Pieces));
-    entity_visible_piece *Piece = Group->Pieces + Group->PieceCount++;
-    Piece->Bitmap = Bitmap;
-    Piece->Offset = Group->GameState->MetersToPixels*V2(Offset.X, -Offset.Y) - Align;
-    Piece->OffsetZ = Group->GameState->MetersToPixels*OffsetZ;
-    Piece->EntityZC = EntityZC;
-    Piece->R = Color.R;
-    Piece->G = Color.G;
-    Piece->B = Color.B;
-    Piece->A = Color.A;
-    Piece->Dim = Dim;
-}
-
-inline void
-PushBitmap(entity_visible_piece_group *Group, loaded_bitmap *Bitmap,
-           v2 Offset, real32 OffsetZ, v2 Align, real32 Alpha = 1.0f, real32 EntityZC = 1.0f)
-{
-    PushPiece(Group, Bitmap, Offset, OffsetZ, Align, V2(0, 0), V4(1.0f, 1.0f, 1.0f, Alpha), EntityZC);
-}
-
-inline void
-PushRect(entity_visible_piece_group *Group, v2 Offset, real32 OffsetZ,
-         v2 Dim, v4 Color, real32 EntityZC = 1.0f)
-{
-    PushPiece(Group, 0, Offset, OffsetZ, V2(0, 0), Dim, Color, EntityZC);
-}
-
 internal void
-DrawHitpoints(sim_entity *Entity, entity_visible_piece_group *PieceGroup)
+DrawHitpoints(sim_entity *Entity, render_group *PieceGroup)
 {
     if(Entity->HitPointMax >= 1)
     {
@@ -459,6 +209,169 @@ DrawHitpoints(sim_entity *Entity, entity_visible_piece_group *PieceGroup)
     }
 }
 
+internal void
+PushEntityPieces(game_state *GameState, render_group *RenderGroup, sim_entity *Entity)
+{
+    real32 ShadowAlpha = 1.0f - 0.5f*Entity->P.Z;
+    if(ShadowAlpha < 0)
+    {
+        ShadowAlpha = 0.0f;
+    }
+
+    hero_bitmaps *HeroBitmaps = &GameState->HeroBitmaps[Entity->FacingDirection];
+    switch(Entity->Type)
+    {
+        case EntityType_Hero:
+        {
+            // TODO(casey): Z!!!
+            PushBitmap(RenderGroup, Asset_Shadow, V2(0, 0), 0, HeroBitmaps->Align, ShadowAlpha, 0.0f);
+            PushBitmap(RenderGroup, HeroBitmaps->Torso, V2(0, 0), 0, HeroBitmaps->Align);
+            PushBitmap(RenderGroup, HeroBitmaps->Cape, V2(0, 0), 0, HeroBitmaps->Align);
+            PushBitmap(RenderGroup, HeroBitmaps->Head, V2(0, 0), 0, HeroBitmaps->Align);
+
+            DrawHitpoints(Entity, RenderGroup);
+        } break;
+
+        case EntityType_Wall:
+        {
+            PushBitmap(RenderGroup, Asset_Tree, V2(0, 0), 0, V2(40, 80));
+        } break;
+
+        case EntityType_Stairwell:
+        {
+            PushRect(RenderGroup, V2(0, 0), 0, Entity->Dim.XY, V4(1, 1, 0, 1), 0.0f);
+        } break;
+
+        case EntityType_Sword:
+        {
+            PushBitmap(RenderGroup, Asset_Shadow, V2(0, 0), 0, HeroBitmaps->Align, ShadowAlpha, 0.0f);
+            PushBitmap(RenderGroup, Asset_Sword, V2(0, 0), 0, V2(29, 10));
+        } break;
+
+        case EntityType_Familiar:
+        {
+            real32 BobSin = Sin(2.0f*Entity->tBob);
+            PushBitmap(RenderGroup, Asset_Shadow, V2(0, 0), 0, HeroBitmaps->Align, (0.5f*ShadowAlpha) + 0.2f*BobSin, 0.0f);
+            PushBitmap(RenderGroup, HeroBitmaps->Head, V2(0, 0), 0.25f*BobSin, HeroBitmaps->Align);
+        } break;
+    
+        case EntityType_Monstar:
+        {
+            PushBitmap(RenderGroup, Asset_Shadow, V2(0, 0), 0, HeroBitmaps->Align, ShadowAlpha, 0.0f);
+            PushBitmap(RenderGroup, HeroBitmaps->Torso, V2(0, 0), 0, HeroBitmaps->Align);
+
+            DrawHitpoints(Entity, RenderGroup);
+        } break;
+
+        InvalidDefaultCase;
+    }
+}
+
+internal void
+PushWorldMapEntity(game_state *GameState, sim_region *SimRegion, render_group *RenderGroup,
+                   memory_arena *BasisArena, rectangle2 ScreenBounds,
+                   uint32 LowEntityIndex, low_entity *Low)
+{
+    if(!IsSet(&Low->Sim, EntityFlag_Nonspatial))
+    {
+        sim_entity Entity = Low->Sim;
+        Entity.P = GetSimSpaceP(SimRegion, Low);
+#if HANDMADE_PERSISTENT_SIM_REGION
+        // NOTE(casey): A persistent region only writes entities back when
+        // they leave it, so the stored copy can be well out of date.
+        if(IsSet(&Low->Sim, EntityFlag_Simming))
+        {
+            Entity = *GetEntityByStorageIndex(SimRegion, LowEntityIndex);
+        }
+#endif
+        Entity.P = Entity.P - SimRegion->CameraOffset;
+                            
+        v2 ScreenP = V2(Entity.P.X, Entity.P.Y + Entity.P.Z);
+        rectangle2 EntityBounds = AddRadiusTo(ScreenBounds, 0.5f*Entity.Dim.XY);
+        if(IsInRectangle(EntityBounds, ScreenP))
+        {
+            render_basis *Basis = PushStruct(BasisArena, render_basis);
+            Basis->P = Entity.P;
+            Basis->SortKey = GetEntitySortKey(Low->P.ChunkZ - SimRegion->Origin.ChunkZ,
+                                              Entity.P.Y, LowEntityIndex);
+            Basis->PieceCount = 0;
+            RenderGroup->DefaultBasis = Basis;
+
+            PushEntityPieces(GameState, RenderGroup, &Entity);
+        }
+    }
+}
+
+internal void
+PushWorldMap(game_state *GameState, sim_region *SimRegion, render_group *RenderGroup,
+             memory_arena *BasisArena, rectangle2 ScreenBounds)
+{
+    // NOTE(casey): Zoomed out, the screen covers far more of the world than
+    // a sim region could ever hold, so this draws the stored entities
+    // straight out of the chunks on the camera's floor without simulating
+    // them.  Anything in the sim region shows up as of the end of last frame.
+    // Paged out chunks are read straight out of the page file rather than
+    // paged in, since the view can cover more chunks than are allowed to
+    // be resident.
+    world *World = SimRegion->World;
+    world_position MinChunkP = MapIntoChunkSpace(World, SimRegion->Origin,
+                                                 V3(GetMinCorner(ScreenBounds), 0.0f) + SimRegion->CameraOffset);
+    world_position MaxChunkP = MapIntoChunkSpace(World, SimRegion->Origin,
+                                                 V3(GetMaxCorner(ScreenBounds), 0.0f) + SimRegion->CameraOffset);
+    int32 ChunkZ = SimRegion->Origin.ChunkZ;
+    for(int32 ChunkY = MinChunkP.ChunkY;
+        ChunkY <= MaxChunkP.ChunkY;
+        ++ChunkY)
+    {
+        for(int32 ChunkX = MinChunkP.ChunkX;
+            ChunkX <= MaxChunkP.ChunkX;
+            ++ChunkX)
+        {
+            world_chunk *Chunk = GetWorldChunk(World, ChunkX, ChunkY, ChunkZ);
+            if(Chunk && Chunk->Paged)
+            {
+                for(uint32 FirstIndex = 0;
+                    FirstIndex < Chunk->PagedEntityCount;
+                    FirstIndex += (uint32)WORLD_PAGE_BATCH_COUNT)
+                {
+                    uint32 Count = ReadPagedEntities(World, Chunk, FirstIndex);
+                    if(!Count)
+                    {
+                        // NOTE(casey): Couldn't read it, so the rest of the
+                        // chunk just doesn't show up this frame
+                        break;
+                    }
+                    
+                    for(uint32 Index = 0;
+                        Index < Count;
+                        ++Index)
+                    {
+                        world_paged_entity *Paged = World->PageBuffer + Index;
+                        PushWorldMapEntity(GameState, SimRegion, RenderGroup, BasisArena, ScreenBounds,
+                                           Paged->LowEntityIndex, &Paged->Low);
+                    }
+                }
+            }
+            else if(Chunk)
+            {
+                for(world_entity_block *Block = &Chunk->FirstBlock;
+                    Block;
+                    Block = Block->Next)
+                {
+                    for(uint32 EntityIndexIndex = 0;
+                        EntityIndexIndex < Block->EntityCount;
+                        ++EntityIndexIndex)
+                    {
+                        uint32 LowEntityIndex = Block->LowEntityIndex[EntityIndexIndex];
+                        PushWorldMapEntity(GameState, SimRegion, RenderGroup, BasisArena, ScreenBounds,
+                                           LowEntityIndex, GameState->LowEntities[LowEntityIndex]);
+                    }
+                }
+            }
+        }
+    }
+}
+
 internal void
 ClearCollisionRulesFor(game_state *GameState, uint32 StorageIndex)
 {
@@ -556,44 +469,30 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     game_state *GameState = (game_state *)Memory->PermanentStorage;
     if(!Memory->IsInitialized)
     {
-        // NOTE(casey): Reserve entity slot 0 for the null entity
-        AddLowEntity(GameState, EntityType_Null, NullPosition());
-
-        GameState->Backdrop =
-            DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_background.bmp");
-        GameState->Shadow =
-            DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_shadow.bmp");
-        GameState->Tree =
-            DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test2/tree00.bmp");
-        GameState->Stairwell =
-            DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test2/rock02.bmp");
-        GameState->Sword =
-            DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test2/rock03.bmp");
-
         hero_bitmaps *Bitmap;
 
         Bitmap = GameState->HeroBitmaps;
-        Bitmap->Head = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_right_head.bmp");
-        Bitmap->Cape = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_right_cape.bmp");
-        Bitmap->Torso = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_right_torso.bmp");
+        Bitmap->Head = Asset_HeroRightHead;
+        Bitmap->Cape = Asset_HeroRightCape;
+        Bitmap->Torso = Asset_HeroRightTorso;
         Bitmap->Align = V2(72, 182);
         ++Bitmap;
 
-        Bitmap->Head = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_back_head.bmp");
-        Bitmap->Cape = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_back_cape.bmp");
-        Bitmap->Torso = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_back_torso.bmp");
+        Bitmap->Head = Asset_HeroBackHead;
+        Bitmap->Cape = Asset_HeroBackCape;
+        Bitmap->Torso = Asset_HeroBackTorso;
         Bitmap->Align = V2(72, 182);
         ++Bitmap;
 
-        Bitmap->Head = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_left_head.bmp");
-        Bitmap->Cape = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_left_cape.bmp");
-        Bitmap->Torso = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_left_torso.bmp");
+        Bitmap->Head = Asset_HeroLeftHead;
+        Bitmap->Cape = Asset_HeroLeftCape;
+        Bitmap->Torso = Asset_HeroLeftTorso;
         Bitmap->Align = V2(72, 182);
         ++Bitmap;
 
-        Bitmap->Head = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_front_head.bmp");
-        Bitmap->Cape = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_front_cape.bmp");
-        Bitmap->Torso = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, "test/test_hero_front_torso.bmp");
+        Bitmap->Head = Asset_HeroFrontHead;
+        Bitmap->Cape = Asset_HeroFrontCape;
+        Bitmap->Torso = Asset_HeroFrontTorso;
         Bitmap->Align = V2(72, 182);
         ++Bitmap;
 
@@ -602,7 +501,18 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 
         GameState->World = PushStruct(&GameState->WorldArena, world);
         world *World = GameState->World;
-        InitializeWorld(World, 1.4f);
+        world_page_file_functions PageFileFunctions = {};
+        PageFileFunctions.OpenScratchFile = Memory->PlatformOpenScratchFile;
+        PageFileFunctions.ReadFromFile = Memory->PlatformReadFromFile;
+        PageFileFunctions.WriteToFile = Memory->PlatformWriteToFile;
+        PageFileFunctions.ReadAheadQueue = Memory->LowPriorityQueue;
+        PageFileFunctions.AddEntry = Memory->PlatformAddEntry;
+        PageFileFunctions.CompleteAllWork = Memory->PlatformCompleteAllWork;
+        InitializeWorld(&GameState->WorldArena, World, 1.4f, &PageFileFunctions,
+                        HANDMADE_RESIDENT_CHUNK_BUDGET);
+
+        // NOTE(casey): Reserve entity slot 0 for the null entity
+        AddLowEntity(GameState, EntityType_Null, NullPosition(), V3(0, 0, 0));
     
         int32 TileSideInPixels = 60;
         GameState->MetersToPixels = (real32)TileSideInPixels / (real32)World->TileSideInMeters;
@@ -727,6 +637,10 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
             DoorRight = false;
             DoorTop = false;
 
+            // NOTE(casey): Each screen counts as a frame as far as paging is
+            // concerned, so the whole world is never resident at once
+            UpdateWorldResidency(World, GameState->LowEntities, !Memory->MemoryMayBeRestored);
+
             if(RandomChoice == 2)
             {
                 if(AbsTileZ == ScreenBaseZ)
@@ -786,8 +700,6 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 
     world *World = GameState->World;
 
-    real32 MetersToPixels = GameState->MetersToPixels;
-
     //
     // NOTE(casey): 
     //
@@ -797,6 +709,16 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     {
         game_controller_input *Controller = GetController(Input, ControllerIndex);
         controlled_hero *ConHero = GameState->ControlledHeroes + ControllerIndex;
+
+        if(WasPressed(Controller->LeftShoulder) && (GameState->DebugZoomLevel > 0))
+        {
+            --GameState->DebugZoomLevel;
+        }
+        if(WasPressed(Controller->RightShoulder) && (GameState->DebugZoomLevel < DEBUG_MAX_ZOOM_LEVEL))
+        {
+            ++GameState->DebugZoomLevel;
+        }
+        
         if(ConHero->EntityIndex == 0)
         {
             if(Controller->Start.EndedDown)
@@ -862,6 +784,55 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         }
     }
         
+    //
+    // NOTE(casey): Transient initialization
+    //
+    
+    Assert(sizeof(transient_state) <= Memory->TransientStorageSize);    
+    transient_state *TranState = (transient_state *)Memory->TransientStorage;
+    if(!TranState->IsInitialized)
+    {
+        InitializeArena(&TranState->TranArena, Memory->TransientStorageSize - sizeof(transient_state),
+                        (uint8 *)Memory->TransientStorage + sizeof(transient_state));
+
+        TranState->Assets = AllocateGameAssets(&TranState->TranArena, HANDMADE_ASSET_BUDGET,
+                                               Thread, Memory);
+
+        // NOTE(casey): Zeroed once here; after that regions just bump its
+        // generation.
+        TranState->SimHash = PushStruct(&TranState->TranArena, sim_entity_hash_table);
+        ZeroStruct(*TranState->SimHash);
+
+#if HANDMADE_PERSISTENT_SIM_REGION
+        memory_index SimArenaSize = Megabytes(4);
+        InitializeArena(&TranState->SimArena, SimArenaSize, PushSize(&TranState->TranArena, SimArenaSize));
+        TranState->SimRegion = 0;
+#endif
+
+        asset_bitmap_id SpriteIDs[] =
+        {
+            Asset_Shadow, Asset_Tree, Asset_Stairwell, Asset_Sword,
+            Asset_HeroRightHead, Asset_HeroRightCape, Asset_HeroRightTorso,
+            Asset_HeroBackHead, Asset_HeroBackCape, Asset_HeroBackTorso,
+            Asset_HeroLeftHead, Asset_HeroLeftCape, Asset_HeroLeftTorso,
+            Asset_HeroFrontHead, Asset_HeroFrontCape, Asset_HeroFrontTorso,
+        };
+
+        // NOTE(casey): Dimensions are known up front even for assets that
+        // haven't streamed in yet, so culling never has to wait on them.
+        TranState->MaxSpriteExtentInPixels = 0.0f;
+        for(uint32 SpriteIndex = 0;
+            SpriteIndex < ArrayCount(SpriteIDs);
+            ++SpriteIndex)
+        {
+            v2 Dim = GetBitmapDim(TranState->Assets, SpriteIDs[SpriteIndex]);
+            TranState->MaxSpriteExtentInPixels = Maximum(TranState->MaxSpriteExtentInPixels, Dim.X);
+            TranState->MaxSpriteExtentInPixels = Maximum(TranState->MaxSpriteExtentInPixels, Dim.Y);
+        }
+
+        TranState->IsInitialized = true;
+    }
+
     // TODO(casey): I am totally picking these numbers randomly!
     uint32 TileSpanX = 17*3;
     uint32 TileSpanY = 9*3;
@@ -871,26 +842,42 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                                                                        (real32)TileSpanY,
                                                                        (real32)TileSpanZ));
 
-    memory_arena SimArena;
-    InitializeArena(&SimArena, Memory->TransientStorageSize, Memory->TransientStorage);
-    sim_region *SimRegion = BeginSim(&SimArena, GameState, GameState->World,
-                                     GameState->CameraP, CameraBounds, Input->dtForFrame);
+    world_position CameraP = GameState->CameraP;
+#if HANDMADE_PERSISTENT_SIM_REGION
+    // NOTE(casey): The region is built a screen bigger than the camera
+    // needs all the way round, and kept until the camera wanders out of
+    // that slack.
+    v3 CameraSlack = World->TileSideInMeters*V3((real32)(TileSpanX/3), (real32)(TileSpanY/3), 0.0f);
+    sim_region *SimRegion = TranState->SimRegion;
+    if(SimRegion && !SimRegionCanFollowCamera(SimRegion, CameraP, CameraSlack))
+    {
+        EndSim(SimRegion, GameState, &TranState->TranArena);
+        EndTemporaryMemory(TranState->SimRegionMemory);
+        SimRegion = 0;
+    }
 
-    //
-    // NOTE(casey): Render
-    //
-#if 1
-    DrawRectangle(Buffer, V2(0.0f, 0.0f), V2((real32)Buffer->Width, (real32)Buffer->Height), 0.5f, 0.5f, 0.5f);
+    if(SimRegion)
+    {
+        RefreshSim(SimRegion, GameState, &TranState->TranArena);
+    }
+    else
+    {
+        TranState->SimRegionMemory = BeginTemporaryMemory(&TranState->SimArena);
+        SimRegion = BeginSim(&TranState->SimArena, TranState->SimHash, GameState, GameState->World,
+                             CameraP, AddRadiusTo(CameraBounds, CameraSlack), Input->dtForFrame);
+    }
+    SetSimRegionCamera(SimRegion, CameraP, CameraBounds);
+    TranState->SimRegion = SimRegion;
 #else
-    DrawBitmap(Buffer, &GameState->Backdrop, 0, 0);
+    temporary_memory SimMemory = BeginTemporaryMemory(&TranState->TranArena);
+    sim_region *SimRegion = BeginSim(&TranState->TranArena, TranState->SimHash, GameState, GameState->World,
+                                     CameraP, CameraBounds, Input->dtForFrame);
 #endif
-    
-    real32 ScreenCenterX = 0.5f*(real32)Buffer->Width;
-    real32 ScreenCenterY = 0.5f*(real32)Buffer->Height;
 
-    // TODO(casey): Move this out into handmade_entity.cpp!
-    entity_visible_piece_group PieceGroup;
-    PieceGroup.GameState = GameState;
+    //
+    // NOTE(casey): Simulate
+    //
+    
     sim_entity *Entity = SimRegion->Entities;
     for(uint32 EntityIndex = 0;
         EntityIndex < SimRegion->EntityCount;
@@ -898,20 +885,11 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     {
         if(Entity->Updatable)
         {
-            PieceGroup.PieceCount = 0;
             real32 dt = Input->dtForFrame;
         
-            // TODO(casey): This is incorrect, should be computed after update!!!!
-            real32 ShadowAlpha = 1.0f - 0.5f*Entity->P.Z;
-            if(ShadowAlpha < 0)
-            {
-                ShadowAlpha = 0.0f;
-            }
-
             move_spec MoveSpec = DefaultMoveSpec();
             v3 ddP = {};
             
-            hero_bitmaps *HeroBitmaps = &GameState->HeroBitmaps[Entity->FacingDirection];
             switch(Entity->Type)
             {
                 case EntityType_Hero:
@@ -942,31 +920,13 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                                 if(Sword && IsSet(Sword, EntityFlag_Nonspatial))
                                 {
                                     Sword->DistanceLimit = 5.0f;
-                                    MakeEntitySpatial(Sword, Entity->P,
-                                                      Entity->dP + 5.0f*V3(ConHero->dSword, 0));
+                                    MakeEntitySpatial(SimRegion, Sword, Entity->P,
+                                                                 Entity->dP + 5.0f*V3(ConHero->dSword, 0));
                                     AddCollisionRule(GameState, Sword->StorageIndex, Entity->StorageIndex, false);
                                 }
                             }
                         }
                     }
-
-                    // TODO(casey): Z!!!
-                    PushBitmap(&PieceGroup, &GameState->Shadow, V2(0, 0), 0, HeroBitmaps->Align, ShadowAlpha, 0.0f);
-                    PushBitmap(&PieceGroup, &HeroBitmaps->Torso, V2(0, 0), 0, HeroBitmaps->Align);
-                    PushBitmap(&PieceGroup, &HeroBitmaps->Cape, V2(0, 0), 0, HeroBitmaps->Align);
-                    PushBitmap(&PieceGroup, &HeroBitmaps->Head, V2(0, 0), 0, HeroBitmaps->Align);
-
-                    DrawHitpoints(Entity, &PieceGroup);
-                } break;
-
-                case EntityType_Wall:
-                {
-                    PushBitmap(&PieceGroup, &GameState->Tree, V2(0, 0), 0, V2(40, 80));
-                } break;
-
-                case EntityType_Stairwell:
-                {
-					PushRect(&PieceGroup, V2(0, 0), 0, Entity->Dim.XY, V4(1, 1, 0, 1), 0.0f);
                 } break;
 
                 case EntityType_Sword:
@@ -978,11 +938,8 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                     if(Entity->DistanceLimit == 0.0f)
                     {
                         ClearCollisionRulesFor(GameState, Entity->StorageIndex);
-                        MakeEntityNonSpatial(Entity);
+                        MakeEntityNonSpatial(SimRegion, Entity);
                     }
-
-                    PushBitmap(&PieceGroup, &GameState->Shadow, V2(0, 0), 0, HeroBitmaps->Align, ShadowAlpha, 0.0f);
-                    PushBitmap(&PieceGroup, &GameState->Sword, V2(0, 0), 0, V2(29, 10));
                 } break;
 
                 case EntityType_Familiar:
@@ -1023,65 +980,196 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                     {
                         Entity->tBob -= (2.0f*Pi32);
                     }
-                    real32 BobSin = Sin(2.0f*Entity->tBob);
-                    PushBitmap(&PieceGroup, &GameState->Shadow, V2(0, 0), 0, HeroBitmaps->Align, (0.5f*ShadowAlpha) + 0.2f*BobSin, 0.0f);
-                    PushBitmap(&PieceGroup, &HeroBitmaps->Head, V2(0, 0), 0.25f*BobSin, HeroBitmaps->Align);
                 } break;
             
+                case EntityType_Wall:
+                case EntityType_Stairwell:
                 case EntityType_Monstar:
                 {
-                    PushBitmap(&PieceGroup, &GameState->Shadow, V2(0, 0), 0, HeroBitmaps->Align, ShadowAlpha, 0.0f);
-                    PushBitmap(&PieceGroup, &HeroBitmaps->Torso, V2(0, 0), 0, HeroBitmaps->Align);
-
-                    DrawHitpoints(Entity, &PieceGroup);
                 } break;
 
-                default:
-                {
-                    InvalidCodePath;
-                } break;
+                InvalidDefaultCase;
             }
 
             if(!IsSet(Entity, EntityFlag_Nonspatial) && IsSet(Entity, EntityFlag_Moveable))
             {
                 MoveEntity(GameState, SimRegion, Entity, Input->dtForFrame, &MoveSpec, ddP);
             }
+        }
+    }
 
-            real32 EntityGroundPointX = ScreenCenterX + MetersToPixels*Entity->P.X;
-            real32 EntityGroundPointY = ScreenCenterY - MetersToPixels*Entity->P.Y;            
-            real32 EntityZ = -MetersToPixels*Entity->P.Z;
-#if 0
-            v2 PlayerLeftTop = {PlayerGroundPointX - 0.5f*MetersToPixels*LowEntity->Width,
-                                PlayerGroundPointY - 0.5f*MetersToPixels*LowEntity->Height};
-            v2 EntityWidthHeight = {LowEntity->Width, LowEntity->Height};
-            DrawRectangle(Buffer, PlayerLeftTop, PlayerLeftTop + 0.9f*MetersToPixels*EntityWidthHeight,
-                          1.0f, 1.0f, 0.0f);
+    //
+    // NOTE(casey): Render
+    //
+
+    if(Memory->ExecutableReloaded)
+    {
+        ResetQueuedAssets(TranState->Assets);
+    }
+
+    // TODO(casey): Decide what our pushbuffer size is!
+    BeginAssetFrame(TranState->Assets);
+    
+    // NOTE(casey): Sprites are authored at GameState->MetersToPixels, and
+    // the debug zoom just shrinks everything from there.
+    real32 BitmapScale = 1.0f / (real32)(1 << GameState->DebugZoomLevel);
+    real32 MetersToPixels = BitmapScale*GameState->MetersToPixels;
+    
+    temporary_memory RenderMemory = BeginTemporaryMemory(&TranState->TranArena);
+    render_group *RenderGroup = AllocateRenderGroup(&TranState->TranArena, Megabytes(4),
+                                                    MetersToPixels, BitmapScale, TranState->Assets);
+    
+#if 1
+    Clear(RenderGroup, V4(0.5f, 0.5f, 0.5f, 0.0f));
+#else
+    PushBitmap(RenderGroup, Asset_Backdrop, V2(0, 0), 0, V2(0, 0));
 #endif
-            for(uint32 PieceIndex = 0;
-                PieceIndex < PieceGroup.PieceCount;
-                ++PieceIndex)
+
+    // NOTE(casey): The sim region is three screens wide, but only what's
+    // on the actual screen can touch a pixel.  Cull against the screen in
+    // meters, grown by the biggest sprite so nothing hanging off its
+    // ground point gets cut, before any pieces are generated.
+    real32 PixelsToMeters = 1.0f / MetersToPixels;
+    v2 ScreenDimInMeters = PixelsToMeters*V2((real32)Buffer->Width, (real32)Buffer->Height);
+    real32 SpriteApron = TranState->MaxSpriteExtentInPixels / GameState->MetersToPixels;
+    rectangle2 ScreenBounds = AddRadiusTo(RectCenterDim(V2(0, 0), ScreenDimInMeters),
+                                          V2(SpriteApron, SpriteApron));
+
+    // NOTE(casey): Anything that shifts the whole screen means last frame's
+    // pixels are no use to us, so everything gets redrawn.  So does the
+    // platform copying in an older game memory, since what's in the
+    // backbuffer was drawn from a different one.
+    dirty_grid *DirtyGrid = AllocateDirtyGrid(&TranState->TranArena, Buffer->Width, Buffer->Height);
+    DirtyGrid->AllDirty = (!HANDMADE_INCREMENTAL_REDRAW ||
+                           Memory->MemoryRestored ||
+                           !TranState->LastFrameValid ||
+                           (TranState->LastBufferWidth != Buffer->Width) ||
+                           (TranState->LastBufferHeight != Buffer->Height) ||
+                           (TranState->LastCameraP.ChunkX != CameraP.ChunkX) ||
+                           (TranState->LastCameraP.ChunkY != CameraP.ChunkY) ||
+                           (TranState->LastCameraP.ChunkZ != CameraP.ChunkZ) ||
+                           (TranState->LastCameraP.Offset_.X != CameraP.Offset_.X) ||
+                           (TranState->LastCameraP.Offset_.Y != CameraP.Offset_.Y) ||
+                           (TranState->LastCameraP.Offset_.Z != CameraP.Offset_.Z));
+
+    if(GameState->DebugZoomLevel)
+    {
+        DirtyGrid->AllDirty = true;
+        PushWorldMap(GameState, SimRegion, RenderGroup, &TranState->TranArena, ScreenBounds);
+    }
+    else
+    {
+        // TODO(casey): Move this out into handmade_entity.cpp!
+        Entity = SimRegion->Entities;
+        for(uint32 EntityIndex = 0;
+            EntityIndex < SimRegion->EntityCount;
+            ++EntityIndex, ++Entity)
+        {
+            if(Entity->Updatable)
             {
-                entity_visible_piece *Piece = PieceGroup.Pieces + PieceIndex;
-                v2 Center = {EntityGroundPointX + Piece->Offset.X,
-                             EntityGroundPointY + Piece->Offset.Y + Piece->OffsetZ + Piece->EntityZC*EntityZ};
-                if(Piece->Bitmap)
+                v3 CameraRelP = Entity->P - SimRegion->CameraOffset;
+                bool32 Visible = !IsSet(Entity, EntityFlag_Nonspatial);
+                if(Visible)
                 {
-                    DrawBitmap(Buffer, Piece->Bitmap, Center.X, Center.Y, Piece->A);
+                    // NOTE(casey): Z lifts things straight up the screen
+                    v2 ScreenP = V2(CameraRelP.X, CameraRelP.Y + CameraRelP.Z);
+                    rectangle2 EntityBounds = AddRadiusTo(ScreenBounds, 0.5f*Entity->Dim.XY);
+                    if(!IsInRectangle(EntityBounds, ScreenP))
+                    {
+                        DEBUG_COUNT(Memory, EntitiesCulled, 1);
+                        Visible = false;
+                    }
                 }
-                else
+
+                if(!Visible)
+                {
+                    // NOTE(casey): Whatever it drew last frame has to go
+                    MarkDirty(DirtyGrid, Entity->ScreenBounds);
+                    Entity->ScreenBounds = {};
+                    Entity->RenderSignature = 0;
+                    continue;
+                }
+                DEBUG_COUNT(Memory, EntitiesRendered, 1);
+
+                uint32 FirstPushBufferOffset = RenderGroup->PushBufferSize;
+                world_position EntityChunkP = MapIntoChunkSpace(World, SimRegion->Origin, Entity->P);
+
+                render_basis *Basis = PushStruct(&TranState->TranArena, render_basis);
+                Basis->P = CameraRelP;
+                Basis->SortKey = GetEntitySortKey(EntityChunkP.ChunkZ - SimRegion->Origin.ChunkZ,
+                                                  CameraRelP.Y, Entity->StorageIndex);
+                Basis->PieceCount = 0;
+                RenderGroup->DefaultBasis = Basis;
+
+                PushEntityPieces(GameState, RenderGroup, Entity);
+
+                uint32 RenderSignature;
+                rectangle2i EntityScreenBounds = GetPushedScreenBounds(RenderGroup, FirstPushBufferOffset,
+                                                                       Buffer, &RenderSignature);
+                if((RenderSignature != Entity->RenderSignature) ||
+                   (EntityScreenBounds.MinX != Entity->ScreenBounds.MinX) ||
+                   (EntityScreenBounds.MinY != Entity->ScreenBounds.MinY) ||
+                   (EntityScreenBounds.MaxX != Entity->ScreenBounds.MaxX) ||
+                   (EntityScreenBounds.MaxY != Entity->ScreenBounds.MaxY))
                 {
-                    v2 HalfDim = 0.5f*MetersToPixels*Piece->Dim;
-                    DrawRectangle(Buffer, Center - HalfDim, Center + HalfDim, Piece->R, Piece->G, Piece->B);
+                    MarkDirty(DirtyGrid, Entity->ScreenBounds);
+                    MarkDirty(DirtyGrid, EntityScreenBounds);
                 }
+                Entity->ScreenBounds = EntityScreenBounds;
+                Entity->RenderSignature = RenderSignature;
             }
         }
     }
 
-    world_position WorldOrigin = {};
-    v3 Diff = Subtract(SimRegion->World, &WorldOrigin, &SimRegion->Origin);
-    DrawRectangle(Buffer, Diff.XY, V2(10.0f, 10.0f), 1.0f, 1.0f, 0.0f);
+    uint32 PixelsRedrawn =
+        IncrementalRenderGroupToOutput(Memory->HighPriorityQueue, Memory->PlatformAddEntry,
+                                       Memory->PlatformCompleteAllWork, RenderGroup, Buffer,
+                                       DirtyGrid, &TranState->TranArena);
+    DEBUG_COUNT(Memory, PixelsRedrawn, PixelsRedrawn);
+
+    // NOTE(casey): The map view doesn't keep any entity's screen bounds up
+    // to date, so coming back from it has to start from scratch.
+    TranState->LastFrameValid = (GameState->DebugZoomLevel == 0);
+    TranState->LastCameraP = CameraP;
+    TranState->LastBufferWidth = Buffer->Width;
+    TranState->LastBufferHeight = Buffer->Height;
+
+    EndTemporaryMemory(RenderMemory);
+
+#if HANDMADE_PERSISTENT_SIM_REGION
+    PruneSim(SimRegion, GameState, &TranState->TranArena);
+#else
+    EndSim(SimRegion, GameState, &TranState->TranArena);
+    EndTemporaryMemory(SimMemory);
+#endif
+
+    // NOTE(casey): Probes over lookups is the average probe length
+    DEBUG_COUNT(Memory, ChunkLookups, World->ChunkLookupCount);
+    DEBUG_COUNT(Memory, ChunkProbes, World->ChunkProbeCount);
+    World->ChunkLookupCount = 0;
+    World->ChunkProbeCount = 0;
+
+    UpdateWorldResidency(World, GameState->LowEntities, !Memory->MemoryMayBeRestored);
+    DEBUG_COUNT(Memory, ChunksPagedIn, World->ChunkPageInCount);
+    DEBUG_COUNT(Memory, ChunksPagedOut, World->ChunkPageOutCount);
+    DEBUG_COUNT(Memory, ChunksReadAhead, World->ChunkReadAheadCount);
+    World->ChunkPageInCount = 0;
+    World->ChunkPageOutCount = 0;
+    World->ChunkReadAheadCount = 0;
+
+    // NOTE(casey): Next frame's sim region will be around wherever the camera
+    // has got to, so that plus another screen all the way round (and the
+    // floors either side, for the stairs) gets read ahead
+    v3 PrefetchMargin = V3(World->TileSideInMeters*(real32)(TileSpanX/3),
+                           World->TileSideInMeters*(real32)(TileSpanY/3),
+                           World->TileDepthInMeters);
+#if HANDMADE_PERSISTENT_SIM_REGION
+    PrefetchMargin += CameraSlack;
+#endif
+    PrefetchWorldChunks(World, GameState->CameraP, AddRadiusTo(CameraBounds, PrefetchMargin));
 
-    EndSim(SimRegion, GameState);
+    CheckArena(&GameState->WorldArena);
+    CheckArena(&TranState->TranArena);
 }
 
 extern "C" GAME_GET_SOUND_SAMPLES(GameGetSoundSamples)
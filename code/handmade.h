@@ -65,6 +65,29 @@
 
 #include "handmade_platform.h"
 
+#if !defined(HANDMADE_INCREMENTAL_REDRAW)
+#define HANDMADE_INCREMENTAL_REDRAW 0
+#endif
+
+#if !defined(HANDMADE_PERSISTENT_SIM_REGION)
+#define HANDMADE_PERSISTENT_SIM_REGION 0
+#endif
+
+// NOTE(casey): Most streamed asset data that can be resident at once -
+// past this, the least recently drawn assets get thrown out.
+#if !defined(HANDMADE_ASSET_BUDGET)
+#define HANDMADE_ASSET_BUDGET Megabytes(16)
+#endif
+
+// NOTE(casey): Most world chunks whose entities can be in memory at once -
+// past this, the least recently simulated ones get their entities paged out
+// to disk.  Only the entities (and their entity blocks) are paged: the chunk
+// records, the chunk hash and the LowEntities table stay resident and still
+// grow with the size of the world.
+#if !defined(HANDMADE_RESIDENT_CHUNK_BUDGET)
+#define HANDMADE_RESIDENT_CHUNK_BUDGET 256
+#endif
+
 #define Minimum(A, B) ((A < B) ? (A) : (B))
 #define Maximum(A, B) ((A > B) ? (A) : (B))
 
@@ -77,6 +100,14 @@ struct memory_arena
     memory_index Size;
     uint8 *Base;
     memory_index Used;
+
+    int32 TempCount;
+};
+
+struct temporary_memory
+{
+    memory_arena *Arena;
+    memory_index Used;
 };
 
 inline void
@@ -85,10 +116,12 @@ InitializeArena(memory_arena *Arena, memory_index Size, void *Base)
     Arena->Size = Size;
     Arena->Base = (uint8 *)Base;
     Arena->Used = 0;
+    Arena->TempCount = 0;
 }
 
 #define PushStruct(Arena, type) (type *)PushSize_(Arena, sizeof(type))
 #define PushArray(Arena, Count, type) (type *)PushSize_(Arena, (Count)*sizeof(type))
+#define PushSize(Arena, Size) PushSize_(Arena, Size)
 inline void *
 PushSize_(memory_arena *Arena, memory_index Size)
 {
@@ -99,37 +132,112 @@ PushSize_(memory_arena *Arena, memory_index Size)
     return(Result);
 }
 
+#define PushAlignedArray(Arena, Count, type, Alignment) (type *)PushAlignedSize_(Arena, (Count)*sizeof(type), Alignment)
+inline void *
+PushAlignedSize_(memory_arena *Arena, memory_index Size, memory_index Alignment)
+{
+    // NOTE(casey): Alignment has to be a power of two
+    Assert(Alignment && !(Alignment & (Alignment - 1)));
+    memory_index AlignmentMask = Alignment - 1;
+    memory_index AlignmentOffset = ((Alignment - ((memory_index)(Arena->Base + Arena->Used) & AlignmentMask)) &
+                                    AlignmentMask);
+    void *Result = (uint8 *)PushSize_(Arena, Size + AlignmentOffset) + AlignmentOffset;
+    
+    return(Result);
+}
+
+inline temporary_memory
+BeginTemporaryMemory(memory_arena *Arena)
+{
+    temporary_memory Result;
+
+    Result.Arena = Arena;
+    Result.Used = Arena->Used;
+
+    ++Arena->TempCount;
+
+    return(Result);
+}
+
+inline void
+EndTemporaryMemory(temporary_memory TempMem)
+{
+    memory_arena *Arena = TempMem.Arena;
+    Assert(Arena->Used >= TempMem.Used);
+    Arena->Used = TempMem.Used;
+    Assert(Arena->TempCount > 0);
+    --Arena->TempCount;
+}
+
+inline void
+CheckArena(memory_arena *Arena)
+{
+    Assert(Arena->TempCount == 0);
+}
+
 #define ZeroStruct(Instance) ZeroSize(sizeof(Instance), &(Instance))
 inline void
 ZeroSize(memory_index Size, void *Ptr)
 {
-    // TODO(casey): Check this guy for performance
+    // NOTE(casey): Bytes up to a 16-byte boundary, then whole SSE stores,
+    // then whatever bytes are left over.
     uint8 *Byte = (uint8 *)Ptr;
+    while(Size && ((memory_index)Byte & 15))
+    {
+        *Byte++ = 0;
+        --Size;
+    }
+
+    __m128i Zero = _mm_setzero_si128();
+    while(Size >= 64)
+    {
+        _mm_store_si128((__m128i *)Byte + 0, Zero);
+        _mm_store_si128((__m128i *)Byte + 1, Zero);
+        _mm_store_si128((__m128i *)Byte + 2, Zero);
+        _mm_store_si128((__m128i *)Byte + 3, Zero);
+        Byte += 64;
+        Size -= 64;
+    }
+    while(Size >= 16)
+    {
+        _mm_store_si128((__m128i *)Byte, Zero);
+        Byte += 16;
+        Size -= 16;
+    }
+
     while(Size--)
     {
         *Byte++ = 0;
     }
 }
 
+inline void
+Copy(memory_index Size, void *SourceInit, void *DestInit)
+{
+    // TODO(casey): Check this guy for performance
+    uint8 *Source = (uint8 *)SourceInit;
+    uint8 *Dest = (uint8 *)DestInit;
+    while(Size--)
+    {
+        *Dest++ = *Source++;
+    }
+}
+
 #include "handmade_intrinsics.h"
 #include "handmade_math.h"
 #include "handmade_world.h"
 #include "handmade_sim_region.h"
 #include "handmade_entity.h"
-
-struct loaded_bitmap
-{
-    int32 Width;
-    int32 Height;
-    uint32 *Pixels;
-};
+#include "handmade_file_formats.h"
+#include "handmade_render_group.h"
+#include "handmade_asset.h"
 
 struct hero_bitmaps
 {
     v2 Align;
-    loaded_bitmap Head;
-    loaded_bitmap Cape;
-    loaded_bitmap Torso;
+    asset_bitmap_id Head;
+    asset_bitmap_id Cape;
+    asset_bitmap_id Torso;
 };
 
 struct low_entity
@@ -139,17 +247,15 @@ struct low_entity
     // Can we do something better here?
     world_position P;
     sim_entity Sim;
-};
 
-struct entity_visible_piece
-{
-    loaded_bitmap *Bitmap;
-    v2 Offset;
-    real32 OffsetZ;
-    real32 EntityZC;
+    // NOTE(casey): Where this entity's index sits in its chunk's entity
+    // blocks, so it can be pulled back out without a search.  Only valid
+    // while P is.
+    world_entity_block *ChunkBlock;
+    uint32 ChunkBlockIndex;
 
-    real32 R, G, B, A;
-    v2 Dim;
+    // NOTE(casey): Only used while the body is on the world's free list
+    low_entity *NextFree;
 };
 
 struct controlled_hero
@@ -174,6 +280,9 @@ struct game_state;
 internal void AddCollisionRule(game_state *GameState, uint32 StorageIndexA, uint32 StorageIndexB, bool32 CanCollide);
 internal void ClearCollisionRulesFor(game_state *GameState, uint32 StorageIndex);
 
+// NOTE(casey): 64x smaller - a view 64 screens across
+#define DEBUG_MAX_ZOOM_LEVEL 6
+
 struct game_state
 {
     memory_arena WorldArena;
@@ -186,41 +295,62 @@ struct game_state
     controlled_hero ControlledHeroes[ArrayCount(((game_input *)0)->Controllers)];
 
     // TODO(casey): Change the name to "stored entity"
+    // NOTE(casey): Indexed by storage index.  The entities themselves are
+    // allocated by the world, and an entry is 0 while its entity's chunk
+    // is paged out.  The table itself is always resident.
+    // TODO(casey): Bound this (and the chunk records) by the resident set
+    // too, instead of by the size of the world.
     uint32 LowEntityCount;
-    low_entity LowEntities[100000];
+    low_entity *LowEntities[100000];
 
-    loaded_bitmap Backdrop;
-    loaded_bitmap Shadow;
     hero_bitmaps HeroBitmaps[4];
 
-    loaded_bitmap Tree;
-    loaded_bitmap Sword;
-    loaded_bitmap Stairwell;
     real32 MetersToPixels;
 
+    // NOTE(casey): Debug zoom - each level halves the scale of the view
+    uint32 DebugZoomLevel;
+
     // TODO(casey): Must be power of two
     pairwise_collision_rule *CollisionRuleHash[256];
     pairwise_collision_rule *FirstFreeCollisionRule;
 };
 
-// TODO(casey): This is dumb, this should just be part of
-// the renderer pushbuffer - add correction of coordinates
-// in there and be done with it.
-struct entity_visible_piece_group
+struct transient_state
 {
-    game_state *GameState;
-    uint32 PieceCount;
-    entity_visible_piece Pieces[32];
+    bool32 IsInitialized;
+    memory_arena TranArena;
+
+    game_assets *Assets;
+    
+    // NOTE(casey): Furthest any sprite pixel can be from its entity's
+    // ground point - the largest bitmap dimension in the asset set.
+    real32 MaxSpriteExtentInPixels;
+
+    // NOTE(casey): Incremental redraw only works off of last frame's
+    // backbuffer, so anything that moves the whole screen invalidates it.
+    bool32 LastFrameValid;
+    world_position LastCameraP;
+    int32 LastBufferWidth;
+    int32 LastBufferHeight;
+
+    sim_entity_hash_table *SimHash;
+
+    // NOTE(casey): Only used with HANDMADE_PERSISTENT_SIM_REGION - the sim
+    // region that's carried from frame to frame, in its own arena.
+    memory_arena SimArena;
+    temporary_memory SimRegionMemory;
+    sim_region *SimRegion;
 };
 
 inline low_entity *
 GetLowEntity(game_state *GameState, uint32 Index)
 {
+    // NOTE(casey): 0 for entities whose chunk is paged out, too
     low_entity *Result = 0;
     
     if((Index > 0) && (Index < GameState->LowEntityCount))
     {
-        Result = GameState->LowEntities + Index;
+        Result = GameState->LowEntities[Index];
     }
 
     return(Result);
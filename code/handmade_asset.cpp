@@ -0,0 +1,557 @@
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Casey Muratori $
+   $Notice: (C) Copyright 2015 by Molly Rocket, Inc. All Rights Reserved. $
+   ======================================================================== */
+
+internal loaded_bitmap
+DEBUGLoadBMP(thread_context *Thread, debug_platform_read_entire_file *ReadEntireFile, char *FileName)
+{
+    loaded_bitmap Result = {};
+    
+    debug_read_file_result ReadResult = ReadEntireFile(Thread, FileName);    
+    if(ReadResult.ContentsSize != 0)
+    {
+        bitmap_header *Header = (bitmap_header *)ReadResult.Contents;
+        Result.Pixels = ConvertBMPPixels(Header);
+        Result.Width = Header->Width;
+        Result.Height = Header->Height;
+        Result.Pitch = Result.Width*(int32)sizeof(uint32);
+        Result.Premultiplied = true;
+    }
+
+    return(Result);
+}
+
+internal bool32
+StringsAreEqual(char *A, char *B)
+{
+    while(*A && (*A == *B))
+    {
+        ++A;
+        ++B;
+    }
+
+    bool32 Result = (*A == *B);
+    return(Result);
+}
+
+inline bool32
+IsInsidePack(platform_mapped_file *File, uint64 Offset, uint64 Count, uint64 ElementSize)
+{
+    // NOTE(casey): Offset + Count*ElementSize <= Size, written so that
+    // nothing the file says can make it wrap
+    bool32 Result = ((Offset <= File->Size) &&
+                     (Count <= ((File->Size - Offset) / ElementSize)));
+    return(Result);
+}
+
+internal bool32
+IsValidPackedBitmap(platform_mapped_file *File, hha_bitmap *Bitmap)
+{
+    bool32 Result = false;
+
+    // NOTE(casey): Lookups compare against Name as a string, so it has to
+    // end inside it
+    bool32 NameIsTerminated = false;
+    for(uint32 CharIndex = 0;
+        CharIndex < ArrayCount(Bitmap->Name);
+        ++CharIndex)
+    {
+        if(Bitmap->Name[CharIndex] == 0)
+        {
+            NameIsTerminated = true;
+            break;
+        }
+    }
+
+    // NOTE(casey): Spans can only say where they are in 16 bits of X
+    if(NameIsTerminated &&
+       (Bitmap->Width >= 0) && (Bitmap->Width <= 0xFFFF) &&
+       (Bitmap->Height >= 0) &&
+       IsInsidePack(File, Bitmap->Pixels, (uint64)Bitmap->Width*Bitmap->Height, sizeof(uint32)) &&
+       IsInsidePack(File, Bitmap->RowFirstSpan, (uint64)Bitmap->Height + 1, sizeof(uint32)) &&
+       IsInsidePack(File, Bitmap->Spans, Bitmap->SpanCount, sizeof(bitmap_span)))
+    {
+        // NOTE(casey): Each row's spans have to come after the last row's and
+        // stay inside the span array, and each span has to stay inside its row
+        uint8 *Base = (uint8 *)File->Memory;
+        uint32 *RowFirstSpan = (uint32 *)(Base + Bitmap->RowFirstSpan);
+        bitmap_span *Spans = (bitmap_span *)(Base + Bitmap->Spans);
+
+        Result = (RowFirstSpan[Bitmap->Height] <= Bitmap->SpanCount);
+        for(int32 Y = 0;
+            Result && (Y < Bitmap->Height);
+            ++Y)
+        {
+            Result = (RowFirstSpan[Y] <= RowFirstSpan[Y + 1]);
+        }
+
+        for(uint32 SpanIndex = RowFirstSpan[0];
+            Result && (SpanIndex < RowFirstSpan[Bitmap->Height]);
+            ++SpanIndex)
+        {
+            bitmap_span *Span = Spans + SpanIndex;
+            Result = ((Span->MinX <= Span->MaxX) &&
+                      (Span->MaxX <= Bitmap->Width));
+        }
+    }
+
+    return(Result);
+}
+
+internal hha_header *
+MapAssetPack(game_memory *Memory, char *FileName)
+{
+    hha_header *Result = 0;
+    
+    if(Memory->PlatformMapFile)
+    {
+        platform_mapped_file File = Memory->PlatformMapFile(FileName);
+        hha_header *Header = (hha_header *)File.Memory;
+        if(Header &&
+           (File.Size >= sizeof(hha_header)) &&
+           (Header->MagicValue == HHA_MAGIC_VALUE) &&
+           (Header->Version == HHA_VERSION) &&
+           IsInsidePack(&File, Header->Bitmaps, Header->BitmapCount, sizeof(hha_bitmap)))
+        {
+            // NOTE(casey): A pack with anything wrong in it gets ignored
+            // entirely, rather than trusting any of it.
+            Result = Header;
+            hha_bitmap *Bitmaps = (hha_bitmap *)((uint8 *)Header + Header->Bitmaps);
+            for(uint32 BitmapIndex = 0;
+                BitmapIndex < Header->BitmapCount;
+                ++BitmapIndex)
+            {
+                if(!IsValidPackedBitmap(&File, Bitmaps + BitmapIndex))
+                {
+                    Result = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    return(Result);
+}
+
+internal loaded_bitmap
+GetPackedBitmap(hha_header *Pack, char *Name)
+{
+    // NOTE(casey): Nothing is copied here - the bitmap points straight into
+    // the mapped file, and is only ever read from by the asset loader.
+    loaded_bitmap Result = {};
+
+    uint8 *Base = (uint8 *)Pack;
+    hha_bitmap *Bitmaps = (hha_bitmap *)(Base + Pack->Bitmaps);
+    for(uint32 BitmapIndex = 0;
+        BitmapIndex < Pack->BitmapCount;
+        ++BitmapIndex)
+    {
+        hha_bitmap *Bitmap = Bitmaps + BitmapIndex;
+        if(StringsAreEqual(Bitmap->Name, Name))
+        {
+            Result.Width = Bitmap->Width;
+            Result.Height = Bitmap->Height;
+            Result.Pitch = Bitmap->Width*(int32)sizeof(uint32);
+            Result.Pixels = (uint32 *)(Base + Bitmap->Pixels);
+            Result.Premultiplied = true;
+            Result.RowFirstSpan = (uint32 *)(Base + Bitmap->RowFirstSpan);
+            Result.Spans = (bitmap_span *)(Base + Bitmap->Spans);
+            break;
+        }
+    }
+
+    return(Result);
+}
+
+// NOTE(casey): Indexed by asset_bitmap_id - the names are what the pack
+// files them under, and where the loose BMPs live if they aren't packed.
+global_variable char *AssetBitmapFileNames[Asset_Count] =
+{
+    "test/test_background.bmp",
+    "test/test_hero_shadow.bmp",
+    "test2/tree00.bmp",
+    "test2/rock02.bmp",
+    "test2/rock03.bmp",
+
+    "test/test_hero_right_head.bmp",
+    "test/test_hero_right_cape.bmp",
+    "test/test_hero_right_torso.bmp",
+
+    "test/test_hero_back_head.bmp",
+    "test/test_hero_back_cape.bmp",
+    "test/test_hero_back_torso.bmp",
+
+    "test/test_hero_left_head.bmp",
+    "test/test_hero_left_cape.bmp",
+    "test/test_hero_left_torso.bmp",
+
+    "test/test_hero_front_head.bmp",
+    "test/test_hero_front_cape.bmp",
+    "test/test_hero_front_torso.bmp",
+};
+
+#define ASSET_MEMORY_ALIGNMENT 16
+
+inline memory_index
+AlignAssetSize(memory_index Size)
+{
+    memory_index Result = (Size + (ASSET_MEMORY_ALIGNMENT - 1)) & ~(memory_index)(ASSET_MEMORY_ALIGNMENT - 1);
+    return(Result);
+}
+
+inline void *
+GetBlockMemory(asset_memory_block *Block)
+{
+    void *Result = Block + 1;
+    return(Result);
+}
+
+internal void
+InsertBlockAfter(asset_memory_block *Prev, asset_memory_block *Block)
+{
+    Block->Prev = Prev;
+    Block->Next = Prev->Next;
+    Block->Prev->Next = Block;
+    Block->Next->Prev = Block;
+}
+
+internal void
+RemoveBlock(asset_memory_block *Block)
+{
+    Block->Prev->Next = Block->Next;
+    Block->Next->Prev = Block->Prev;
+    Block->Prev = Block->Next = 0;
+}
+
+internal asset_memory_block *
+AcquireAssetMemory(game_assets *Assets, memory_index Size)
+{
+    asset_memory_block *Result = 0;
+
+    // TODO(casey): First fit is fine for a couple dozen bitmaps, but will
+    // want to be best fit (or size classes) once there are real assets.
+    Size = AlignAssetSize(Size);
+    asset_memory_block *Sentinel = &Assets->MemorySentinel;
+    for(asset_memory_block *Block = Sentinel->Next;
+        Block != Sentinel;
+        Block = Block->Next)
+    {
+        if(!Block->Used && (Block->Size >= Size))
+        {
+            // NOTE(casey): Only split if what's left over could hold
+            // something, otherwise just hand out the whole block.
+            memory_index Remaining = Block->Size - Size;
+            if(Remaining > (sizeof(asset_memory_block) + ASSET_MEMORY_ALIGNMENT))
+            {
+                asset_memory_block *Split = (asset_memory_block *)
+                    ((uint8 *)GetBlockMemory(Block) + Size);
+                Split->Size = Remaining - sizeof(asset_memory_block);
+                Split->Used = false;
+                InsertBlockAfter(Block, Split);
+
+                Block->Size = Size;
+            }
+
+            Block->Used = true;
+            Assets->BudgetUsed += Block->Size;
+            Result = Block;
+            break;
+        }
+    }
+
+    return(Result);
+}
+
+internal void
+MergeIfFree(game_assets *Assets, asset_memory_block *First, asset_memory_block *Second)
+{
+    // NOTE(casey): Blocks are only ever split, never moved, so neighbors in
+    // the list are always neighbors in memory too.
+    if((First != &Assets->MemorySentinel) &&
+       (Second != &Assets->MemorySentinel) &&
+       !First->Used &&
+       !Second->Used)
+    {
+        Assert(((uint8 *)GetBlockMemory(First) + First->Size) == (uint8 *)Second);
+        First->Size += sizeof(asset_memory_block) + Second->Size;
+        RemoveBlock(Second);
+    }
+}
+
+internal void
+ReleaseAssetMemory(game_assets *Assets, asset_memory_block *Block)
+{
+    Assert(Block->Used);
+    Block->Used = false;
+    Assets->BudgetUsed -= Block->Size;
+
+    MergeIfFree(Assets, Block, Block->Next);
+    MergeIfFree(Assets, Block->Prev, Block);
+}
+
+internal void
+RemoveFromLRU(asset_slot *Slot)
+{
+    Slot->PrevLRU->NextLRU = Slot->NextLRU;
+    Slot->NextLRU->PrevLRU = Slot->PrevLRU;
+    Slot->PrevLRU = Slot->NextLRU = 0;
+}
+
+internal void
+InsertAtFrontOfLRU(game_assets *Assets, asset_slot *Slot)
+{
+    asset_slot *Sentinel = &Assets->LRUSentinel;
+    Slot->PrevLRU = Sentinel;
+    Slot->NextLRU = Sentinel->NextLRU;
+    Slot->PrevLRU->NextLRU = Slot;
+    Slot->NextLRU->PrevLRU = Slot;
+}
+
+internal bool32
+EvictLeastRecentlyUsed(game_assets *Assets)
+{
+    bool32 Result = false;
+
+    // NOTE(casey): Anything used this frame may already have been pushed,
+    // and anything still queued is being written by the loader, so neither
+    // can go - if that's all that's left, the request just has to wait.
+    asset_slot *Sentinel = &Assets->LRUSentinel;
+    for(asset_slot *Slot = Sentinel->PrevLRU;
+        Slot != Sentinel;
+        Slot = Slot->PrevLRU)
+    {
+        if((Slot->State == AssetState_Loaded) &&
+           (Slot->LastUsedFrame != Assets->FrameIndex))
+        {
+            RemoveFromLRU(Slot);
+            ReleaseAssetMemory(Assets, Slot->Block);
+            Slot->Block = 0;
+            Slot->Bitmap.Pixels = 0;
+            Slot->Bitmap.RowFirstSpan = 0;
+            Slot->Bitmap.Spans = 0;
+            Slot->Bitmap.NextMip = 0;
+            Slot->State = AssetState_Unloaded;
+
+            Result = true;
+            break;
+        }
+    }
+
+    return(Result);
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(LoadAssetWork)
+{
+    asset_slot *Slot = (asset_slot *)Data;
+    loaded_bitmap *Source = &Slot->Source;
+    loaded_bitmap *Bitmap = &Slot->Bitmap;
+
+    // NOTE(casey): This is where the pages of the mapped pack actually get
+    // faulted in, so it's the part that has to stay off the main thread.
+    memory_index PixelsSize = (memory_index)Source->Height*Source->Pitch;
+    memory_index RowFirstSpanSize = ((memory_index)Source->Height + 1)*sizeof(uint32);
+    
+    uint8 *Dest = (uint8 *)GetBlockMemory(Slot->Block);
+    Copy(PixelsSize, Source->Pixels, Dest);
+    Bitmap->Pixels = (uint32 *)Dest;
+    Dest += PixelsSize;
+
+    Copy(RowFirstSpanSize, Source->RowFirstSpan, Dest);
+    Bitmap->RowFirstSpan = (uint32 *)Dest;
+    Dest += RowFirstSpanSize;
+
+    memory_index SpansSize = Bitmap->RowFirstSpan[Source->Height]*sizeof(bitmap_span);
+    Copy(SpansSize, Source->Spans, Dest);
+    Bitmap->Spans = (bitmap_span *)Dest;
+    Dest += SpansSize;
+
+    Bitmap->NextMip = 0;
+    BuildMipChain(Bitmap, Dest);
+    
+    CompletePreviousWritesBeforeFutureWrites;
+    
+    Slot->State = AssetState_Loaded;
+}
+
+internal game_assets *
+AllocateGameAssets(memory_arena *Arena, memory_index BudgetSize,
+                   thread_context *Thread, game_memory *Memory)
+{
+    game_assets *Assets = PushStruct(Arena, game_assets);
+    
+    Assets->LoadQueue = Memory->LowPriorityQueue;
+    Assets->AddEntry = Memory->PlatformAddEntry;
+    Assets->FrameIndex = 0;
+    Assets->LRUSentinel.PrevLRU = Assets->LRUSentinel.NextLRU = &Assets->LRUSentinel;
+
+    // NOTE(casey): The whole budget starts out as one free block
+    uint8 *BudgetMemory = (uint8 *)PushSize(Arena, BudgetSize + ASSET_MEMORY_ALIGNMENT);
+    BudgetMemory = (uint8 *)AlignAssetSize((memory_index)BudgetMemory);
+    Assert(BudgetSize > sizeof(asset_memory_block));
+    Assert((sizeof(asset_memory_block) % ASSET_MEMORY_ALIGNMENT) == 0);
+    Assets->BudgetSize = BudgetSize;
+    Assets->BudgetUsed = 0;
+    Assets->MemorySentinel.Prev = Assets->MemorySentinel.Next = &Assets->MemorySentinel;
+    asset_memory_block *Block = (asset_memory_block *)BudgetMemory;
+    Block->Size = BudgetSize - sizeof(asset_memory_block);
+    Block->Used = false;
+    InsertBlockAfter(&Assets->MemorySentinel, Block);
+
+    hha_header *Pack = MapAssetPack(Memory, "test.hha");
+    
+    loaded_bitmap *LooseBitmaps[Asset_Count];
+    uint32 LooseBitmapCount = 0;
+    for(uint32 AssetIndex = 0;
+        AssetIndex < Asset_Count;
+        ++AssetIndex)
+    {
+        asset_slot *Slot = Assets->Slots + AssetIndex;
+        char *FileName = AssetBitmapFileNames[AssetIndex];
+
+        if(Pack)
+        {
+            Slot->Source = GetPackedBitmap(Pack, FileName);
+        }
+        
+        if(Slot->Source.Pixels)
+        {
+            // NOTE(casey): Only the dimensions are known until it's requested
+            Slot->Bitmap.Width = Slot->Source.Width;
+            Slot->Bitmap.Height = Slot->Source.Height;
+            Slot->Bitmap.Pitch = Slot->Source.Pitch;
+            Slot->Bitmap.Premultiplied = true;
+
+            uint32 SpanCount = Slot->Source.RowFirstSpan[Slot->Source.Height];
+            Slot->Size = ((memory_index)Slot->Source.Height*Slot->Source.Pitch +
+                          ((memory_index)Slot->Source.Height + 1)*sizeof(uint32) +
+                          (memory_index)SpanCount*sizeof(bitmap_span) +
+                          GetMipChainSize(Slot->Source.Width, Slot->Source.Height));
+            Slot->State = AssetState_Unloaded;
+        }
+        else
+        {
+            // NOTE(casey): Not packed (or no pack), so it comes from the loose
+            // BMP right now, and stays loaded for good since there's nothing
+            // cheaper to get it back from.
+            Slot->Bitmap = DEBUGLoadBMP(Thread, Memory->DEBUGPlatformReadEntireFile, FileName);
+            Slot->State = AssetState_Loaded;
+            if(AssetIndex != Asset_Backdrop)
+            {
+                LooseBitmaps[LooseBitmapCount++] = &Slot->Bitmap;
+            }
+        }
+    }
+
+    // NOTE(casey): Bitmaps from the pack are already laid out together
+    // in the file, so only the loose ones need gathering into an atlas.
+    PackBitmapAtlas(Arena, LooseBitmapCount, LooseBitmaps);
+    for(uint32 AssetIndex = 0;
+        AssetIndex < Asset_Count;
+        ++AssetIndex)
+    {
+        asset_slot *Slot = Assets->Slots + AssetIndex;
+        if(!Slot->Source.Pixels && Slot->Bitmap.Pixels)
+        {
+            BuildBitmapSpans(Arena, &Slot->Bitmap);
+            BuildBitmapMips(Arena, &Slot->Bitmap);
+        }
+    }
+    
+    return(Assets);
+}
+
+internal void
+ResetQueuedAssets(game_assets *Assets)
+{
+    // NOTE(casey): The platform finishes the load queue before it reloads
+    // the game code, so anything still marked Queued after a reload has no
+    // load coming and would never finish.  It goes back to Unloaded, to get
+    // queued again the next time it's asked for.
+    for(uint32 AssetIndex = 0;
+        AssetIndex < Asset_Count;
+        ++AssetIndex)
+    {
+        asset_slot *Slot = Assets->Slots + AssetIndex;
+        if(Slot->State == AssetState_Queued)
+        {
+            RemoveFromLRU(Slot);
+            ReleaseAssetMemory(Assets, Slot->Block);
+            Slot->Block = 0;
+            Slot->State = AssetState_Unloaded;
+        }
+    }
+}
+
+inline void
+BeginAssetFrame(game_assets *Assets)
+{
+    ++Assets->FrameIndex;
+}
+
+internal v2
+GetBitmapDim(game_assets *Assets, asset_bitmap_id ID)
+{
+    loaded_bitmap *Bitmap = &Assets->Slots[ID].Bitmap;
+    v2 Result = {(real32)Bitmap->Width, (real32)Bitmap->Height};
+    return(Result);
+}
+
+internal loaded_bitmap *
+GetBitmap(game_assets *Assets, asset_bitmap_id ID)
+{
+    // NOTE(casey): Never waits - if the bitmap isn't in memory yet this
+    // kicks off the load (if it hasn't been already) and returns 0, and
+    // the caller draws something else in the meantime.
+    loaded_bitmap *Result = 0;
+
+    asset_slot *Slot = Assets->Slots + ID;
+    if((Slot->State == AssetState_Unloaded) && Slot->Source.Pixels)
+    {
+        asset_memory_block *Block = AcquireAssetMemory(Assets, Slot->Size);
+        while(!Block && EvictLeastRecentlyUsed(Assets))
+        {
+            Block = AcquireAssetMemory(Assets, Slot->Size);
+        }
+
+        if(Block)
+        {
+            Slot->Block = Block;
+            Slot->State = AssetState_Queued;
+            InsertAtFrontOfLRU(Assets, Slot);
+            if(Assets->LoadQueue)
+            {
+                Assets->AddEntry(Assets->LoadQueue, LoadAssetWork, Slot);
+            }
+            else
+            {
+                LoadAssetWork(0, Slot);
+            }
+        }
+    }
+
+    if(Slot->State == AssetState_Loaded)
+    {
+        CompletePreviousReadsBeforeFutureReads;
+        
+        if(Slot->Bitmap.Pixels)
+        {
+            Result = &Slot->Bitmap;
+        }
+    }
+
+    // NOTE(casey): Streamed slots move to the front of the LRU whenever
+    // they're asked for, loaded or not, so eviction takes the ones that
+    // have gone longest without being drawn.
+    if(Slot->PrevLRU)
+    {
+        RemoveFromLRU(Slot);
+        InsertAtFrontOfLRU(Assets, Slot);
+    }
+    Slot->LastUsedFrame = Assets->FrameIndex;
+
+    return(Result);
+}
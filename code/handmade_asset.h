@@ -0,0 +1,97 @@
+#if !defined(HANDMADE_ASSET_H)
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Casey Muratori $
+   $Notice: (C) Copyright 2015 by Molly Rocket, Inc. All Rights Reserved. $
+   ======================================================================== */
+
+enum asset_bitmap_id
+{
+    Asset_Backdrop,
+    Asset_Shadow,
+    Asset_Tree,
+    Asset_Stairwell,
+    Asset_Sword,
+
+    Asset_HeroRightHead,
+    Asset_HeroRightCape,
+    Asset_HeroRightTorso,
+
+    Asset_HeroBackHead,
+    Asset_HeroBackCape,
+    Asset_HeroBackTorso,
+
+    Asset_HeroLeftHead,
+    Asset_HeroLeftCape,
+    Asset_HeroLeftTorso,
+
+    Asset_HeroFrontHead,
+    Asset_HeroFrontCape,
+    Asset_HeroFrontTorso,
+
+    Asset_Count,
+};
+
+enum asset_state
+{
+    AssetState_Unloaded,
+    AssetState_Queued,
+    AssetState_Loaded,
+};
+
+struct asset_memory_block
+{
+    // NOTE(casey): Blocks are kept in address order, so a freed block can
+    // merge with whichever neighbors are free too.
+    asset_memory_block *Prev;
+    asset_memory_block *Next;
+    memory_index Size; // NOTE(casey): Not counting this header
+    bool32 Used;
+};
+
+struct asset_slot
+{
+    // NOTE(casey): Only the loader thread moves a slot from Queued to
+    // Loaded; every other transition happens on the main thread.
+    uint32 volatile State;
+
+    // NOTE(casey): Always valid for Width and Height - the rest is only
+    // valid once the slot is Loaded.
+    loaded_bitmap Bitmap;
+    
+    // NOTE(casey): Where the loader copies from - points straight into
+    // the mapped pack, and is 0 for anything that didn't come from it.
+    loaded_bitmap Source;
+    memory_index Size;
+    asset_memory_block *Block;
+    uint32 LastUsedFrame;
+
+    // NOTE(casey): Streamed slots are kept most-recently-used first.
+    // Slots that were loaded up front never join the list, so they're
+    // never evicted.
+    asset_slot *PrevLRU;
+    asset_slot *NextLRU;
+};
+
+struct game_assets
+{
+    platform_work_queue *LoadQueue;
+    platform_add_entry *AddEntry;
+    
+    memory_index BudgetSize;
+    memory_index BudgetUsed;
+    asset_memory_block MemorySentinel;
+
+    asset_slot LRUSentinel;
+    uint32 FrameIndex;
+    
+    asset_slot Slots[Asset_Count];
+};
+
+internal loaded_bitmap *GetBitmap(game_assets *Assets, asset_bitmap_id ID);
+internal v2 GetBitmapDim(game_assets *Assets, asset_bitmap_id ID);
+
+#define HANDMADE_ASSET_H
+#endif
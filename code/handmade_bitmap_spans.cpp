@@ -0,0 +1,99 @@
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Casey Muratori $
+   $Notice: (C) Copyright 2015 by Molly Rocket, Inc. All Rights Reserved. $
+   ======================================================================== */
+
+// NOTE(casey): This is shared between the game and the asset builder, so
+// it can only depend on handmade_platform.h and handmade_file_formats.h.
+
+// NOTE(casey): Runs shorter than this aren't worth breaking a blend run
+// for - blending an opaque or fully transparent pixel gives exactly the
+// same answer as copying or skipping it.
+#define MIN_BITMAP_SPAN_LENGTH 8
+
+struct bitmap_span_builder
+{
+    bitmap_span *Out;
+    uint32 Count;
+    bitmap_span Last;
+};
+
+inline void
+EmitSpan(bitmap_span_builder *Builder, int32 MinX, int32 MaxX, uint32 Type)
+{
+    if(Builder->Count &&
+       (Builder->Last.Type == Type) &&
+       (Builder->Last.MaxX == MinX))
+    {
+        Builder->Last.MaxX = (uint16)MaxX;
+    }
+    else
+    {
+        Builder->Last.MinX = (uint16)MinX;
+        Builder->Last.MaxX = (uint16)MaxX;
+        Builder->Last.Type = Type;
+        ++Builder->Count;
+    }
+
+    if(Builder->Out)
+    {
+        Builder->Out[Builder->Count - 1] = Builder->Last;
+    }
+}
+
+// NOTE(casey): Returns the number of spans in the row, and writes them
+// out too if Out is non-zero.
+internal uint32
+BuildRowSpans(uint32 *Row, int32 Width, bitmap_span *Out)
+{
+    bitmap_span_builder Builder = {};
+    Builder.Out = Out;
+
+    int32 RunMinX = 0;
+    while(RunMinX < Width)
+    {
+        // NOTE(casey): Skip means nothing at all to add, which after
+        // premultiplication is exactly a zero pixel
+        uint32 First = Row[RunMinX];
+        uint32 FirstAlpha = (First >> 24);
+        int32 RunKind = ((First == 0) ? 0 : ((FirstAlpha == 0xFF) ? 1 : 2));
+
+        int32 RunMaxX = RunMinX + 1;
+        while(RunMaxX < Width)
+        {
+            uint32 C = Row[RunMaxX];
+            int32 Kind = ((C == 0) ? 0 : (((C >> 24) == 0xFF) ? 1 : 2));
+            if(Kind != RunKind)
+            {
+                break;
+            }
+            ++RunMaxX;
+        }
+
+        bool32 Short = ((RunMaxX - RunMinX) < MIN_BITMAP_SPAN_LENGTH);
+        if(RunKind == 0)
+        {
+            // NOTE(casey): A short gap inside the row is cheaper to blend
+            // through than to break the run for.
+            if(Short && Builder.Count && (RunMaxX < Width))
+            {
+                EmitSpan(&Builder, RunMinX, RunMaxX, BitmapSpan_Blend);
+            }
+        }
+        else if((RunKind == 1) && !Short)
+        {
+            EmitSpan(&Builder, RunMinX, RunMaxX, BitmapSpan_Copy);
+        }
+        else
+        {
+            EmitSpan(&Builder, RunMinX, RunMaxX, BitmapSpan_Blend);
+        }
+        
+        RunMinX = RunMaxX;
+    }
+
+    return(Builder.Count);
+}
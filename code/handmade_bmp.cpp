@@ -0,0 +1,144 @@
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Casey Muratori $
+   $Notice: (C) Copyright 2015 by Molly Rocket, Inc. All Rights Reserved. $
+   ======================================================================== */
+
+// NOTE(casey): This is shared between the game and the asset builder, so
+// it can only depend on handmade_platform.h and handmade_intrinsics.h.  Both
+// have to turn a BMP into exactly the same pixels, since the game falls back
+// to loose BMPs for anything that isn't in the pack.
+
+#pragma pack(push, 1)
+struct bitmap_header
+{
+    uint16 FileType;
+    uint32 FileSize;
+    uint16 Reserved1;
+    uint16 Reserved2;
+    uint32 BitmapOffset;
+    uint32 Size;
+    int32 Width;
+    int32 Height;
+    uint16 Planes;
+    uint16 BitsPerPixel;
+    uint32 Compression;
+    uint32 SizeOfBitmap;
+    int32 HorzResolution;
+    int32 VertResolution;
+    uint32 ColorsUsed;
+    uint32 ColorsImportant;
+
+    uint32 RedMask;
+    uint32 GreenMask;
+    uint32 BlueMask;
+};
+#pragma pack(pop)
+
+internal uint32 *
+ConvertBMPPixels(bitmap_header *Header)
+{
+    // NOTE(casey): Converts the pixels of a BMP that's been read into memory
+    // in place, to premultiplied BB GG RR AA, and returns them.
+    uint32 *Pixels = (uint32 *)((uint8 *)Header + Header->BitmapOffset);
+    Assert(Header->Compression == 3);
+
+    // NOTE(casey): If you are using this generically for some reason,
+    // please remember that BMP files CAN GO IN EITHER DIRECTION and
+    // the height will be negative for top-down.
+    // (Also, there can be compression, etc., etc... DON'T think this
+    // is complete BMP loading code because it isn't!!)
+
+    // NOTE(casey): Byte order in memory is determined by the Header itself,
+    // so we have to read out the masks and convert the pixels ourselves.
+    uint32 RedMask = Header->RedMask;
+    uint32 GreenMask = Header->GreenMask;
+    uint32 BlueMask = Header->BlueMask;
+    uint32 AlphaMask = ~(RedMask | GreenMask | BlueMask);        
+
+    bit_scan_result RedScan = FindLeastSignificantSetBit(RedMask);
+    bit_scan_result GreenScan = FindLeastSignificantSetBit(GreenMask);
+    bit_scan_result BlueScan = FindLeastSignificantSetBit(BlueMask);
+    bit_scan_result AlphaScan = FindLeastSignificantSetBit(AlphaMask);
+
+    Assert(RedScan.Found);
+    Assert(GreenScan.Found);
+    Assert(BlueScan.Found);
+    Assert(AlphaScan.Found);
+
+    int32 RedShift = 0 - (int32)RedScan.Index;
+    int32 GreenShift = 0 - (int32)GreenScan.Index;
+    int32 BlueShift = 0 - (int32)BlueScan.Index;
+    int32 AlphaShift = 0 - (int32)AlphaScan.Index;
+
+    // NOTE(casey): Premultiply alpha in the same pass as the swizzle,
+    // so the blitter never has to touch the straight-alpha form.
+    real32 Inv255 = 1.0f / 255.0f;
+    uint32 *SourceDest = Pixels;
+    int32 PixelCount = Header->Width*Header->Height;
+    int32 PixelIndex = 0;
+
+    // NOTE(casey): Every BMP we actually ship has 8-bit channels, and
+    // those come out with a plain shift and mask, so they can go four
+    // pixels at a time.  The math is the same as the loop below, op for
+    // op, so both produce exactly the same bits.
+    if(((RedMask >> RedScan.Index) == 0xFF) &&
+       ((GreenMask >> GreenScan.Index) == 0xFF) &&
+       ((BlueMask >> BlueScan.Index) == 0xFF) &&
+       ((AlphaMask >> AlphaScan.Index) == 0xFF))
+    {
+        __m128i RedShift_4x = _mm_cvtsi32_si128((int32)RedScan.Index);
+        __m128i GreenShift_4x = _mm_cvtsi32_si128((int32)GreenScan.Index);
+        __m128i BlueShift_4x = _mm_cvtsi32_si128((int32)BlueScan.Index);
+        __m128i AlphaShift_4x = _mm_cvtsi32_si128((int32)AlphaScan.Index);
+        __m128i MaskFF_4x = _mm_set1_epi32(0xFF);
+        __m128 Inv255_4x = _mm_set1_ps(Inv255);
+        __m128 One_2_4x = _mm_set1_ps(0.5f);
+
+        while((PixelIndex + 4) <= PixelCount)
+        {
+            __m128i C = _mm_loadu_si128((__m128i *)SourceDest);
+
+            __m128i A = _mm_and_si128(_mm_srl_epi32(C, AlphaShift_4x), MaskFF_4x);
+            __m128i R = _mm_and_si128(_mm_srl_epi32(C, RedShift_4x), MaskFF_4x);
+            __m128i G = _mm_and_si128(_mm_srl_epi32(C, GreenShift_4x), MaskFF_4x);
+            __m128i B = _mm_and_si128(_mm_srl_epi32(C, BlueShift_4x), MaskFF_4x);
+
+            __m128 AN = _mm_mul_ps(_mm_cvtepi32_ps(A), Inv255_4x);
+            R = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(R), AN), One_2_4x));
+            G = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(G), AN), One_2_4x));
+            B = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(B), AN), One_2_4x));
+
+            __m128i Out = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(A, 24),
+                                                    _mm_slli_epi32(R, 16)),
+                                       _mm_or_si128(_mm_slli_epi32(G, 8),
+                                                    B));
+            _mm_storeu_si128((__m128i *)SourceDest, Out);
+
+            SourceDest += 4;
+            PixelIndex += 4;
+        }
+    }
+
+    while(PixelIndex < PixelCount)
+    {
+        uint32 C = *SourceDest;
+
+        uint32 A = RotateLeft(C & AlphaMask, AlphaShift);
+        real32 AN = (real32)A*Inv255;
+        real32 R = (real32)RotateLeft(C & RedMask, RedShift)*AN;
+        real32 G = (real32)RotateLeft(C & GreenMask, GreenShift)*AN;
+        real32 B = (real32)RotateLeft(C & BlueMask, BlueShift)*AN;
+
+        *SourceDest++ = ((A << 24) |
+                         ((uint32)(R + 0.5f) << 16) |
+                         ((uint32)(G + 0.5f) << 8) |
+                         ((uint32)(B + 0.5f) << 0));
+        ++PixelIndex;
+    }
+
+
+    return(Pixels);
+}
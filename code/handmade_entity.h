@@ -30,18 +30,20 @@ ClearFlags(sim_entity *Entity, uint32 Flag)
 }
 
 inline void
-MakeEntityNonSpatial(sim_entity *Entity)
+MakeEntityNonSpatial(sim_region *SimRegion, sim_entity *Entity)
 {
     AddFlags(Entity, EntityFlag_Nonspatial);
     Entity->P = InvalidP;
+    UpdateSimSweep(SimRegion, Entity);
 }
 
 inline void
-MakeEntitySpatial(sim_entity *Entity, v3 P, v3 dP)
+MakeEntitySpatial(sim_region *SimRegion, sim_entity *Entity, v3 P, v3 dP)
 {
     ClearFlags(Entity, EntityFlag_Nonspatial);
     Entity->P = P;
     Entity->dP = dP;
+    UpdateSimSweep(SimRegion, Entity);
 }
 
 #define HANDMADE_ENTITY_H
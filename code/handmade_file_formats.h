@@ -0,0 +1,66 @@
+#if !defined(HANDMADE_FILE_FORMATS_H)
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Casey Muratori $
+   $Notice: (C) Copyright 2015 by Molly Rocket, Inc. All Rights Reserved. $
+   ======================================================================== */
+
+enum bitmap_span_type
+{
+    BitmapSpan_Copy,
+    BitmapSpan_Blend,
+};
+struct bitmap_span
+{
+    // NOTE(casey): [MinX, MaxX) in bitmap pixels.  Fully transparent runs
+    // are never stored - they're just the gaps between spans.
+    uint16 MinX;
+    uint16 MaxX;
+    uint32 Type; // NOTE(casey): bitmap_span_type
+};
+
+#define HHA_CODE(a, b, c, d) (((uint32)(a) << 0) | ((uint32)(b) << 8) | ((uint32)(c) << 16) | ((uint32)(d) << 24))
+
+// NOTE(casey): Everything in the pack is laid out so that it can be used
+// exactly where it sits in a read-only mapping of the file.  All offsets
+// are from the start of the file.
+#define HHA_DATA_ALIGNMENT 64
+
+#pragma pack(push, 1)
+struct hha_header
+{
+#define HHA_MAGIC_VALUE HHA_CODE('h','h','a','f')
+    uint32 MagicValue;
+
+#define HHA_VERSION 0
+    uint32 Version;
+
+    uint32 BitmapCount;
+    uint32 Reserved;
+    
+    uint64 Bitmaps; // NOTE(casey): hha_bitmap[BitmapCount]
+};
+
+struct hha_bitmap
+{
+    // NOTE(casey): The path the bitmap was built from, which is also what
+    // the game asks for it by.
+    char Name[64];
+    
+    int32 Width;
+    int32 Height;
+    uint32 SpanCount;
+    uint32 Reserved;
+
+    // NOTE(casey): Bottom-up rows of premultiplied 0xAARRGGBB, Width*4 bytes
+    // apart, starting on an HHA_DATA_ALIGNMENT boundary.
+    uint64 Pixels;
+    uint64 RowFirstSpan; // NOTE(casey): uint32[Height + 1]
+    uint64 Spans; // NOTE(casey): bitmap_span[SpanCount]
+};
+#pragma pack(pop)
+
+#define HANDMADE_FILE_FORMATS_H
+#endif
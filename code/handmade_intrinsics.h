@@ -132,16 +132,11 @@ FindLeastSignificantSetBit(uint32 Value)
 #if COMPILER_MSVC
     Result.Found = _BitScanForward((unsigned long *)&Result.Index, Value);
 #else
-    for(uint32 Test = 0;
-        Test < 32;
-        ++Test)
+    // NOTE(casey): ctz is undefined for 0, so that has to be checked first
+    if(Value)
     {
-        if(Value & (1 << Test))
-        {
-            Result.Index = Test;
-            Result.Found = true;
-            break;
-        }
+        Result.Index = (uint32)__builtin_ctz(Value);
+        Result.Found = true;
     }
 #endif
     
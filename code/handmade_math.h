@@ -64,6 +64,12 @@ struct rectangle3
     v3 Max;
 };
 
+struct rectangle2i
+{
+    int32 MinX, MinY;
+    int32 MaxX, MaxY;
+};
+
 inline v2
 V2(real32 X, real32 Y)
 {
@@ -466,6 +472,56 @@ IsInRectangle(rectangle2 Rectangle, v2 Test)
     return(Result);
 }
 
+//
+// NOTE(casey): Rectangle2i
+//
+
+inline rectangle2i
+Intersect(rectangle2i A, rectangle2i B)
+{
+    rectangle2i Result;
+
+    Result.MinX = (A.MinX < B.MinX) ? B.MinX : A.MinX;
+    Result.MinY = (A.MinY < B.MinY) ? B.MinY : A.MinY;
+    Result.MaxX = (A.MaxX > B.MaxX) ? B.MaxX : A.MaxX;
+    Result.MaxY = (A.MaxY > B.MaxY) ? B.MaxY : A.MaxY;
+
+    return(Result);
+}
+
+inline bool32
+HasArea(rectangle2i A)
+{
+    bool32 Result = ((A.MinX < A.MaxX) && (A.MinY < A.MaxY));
+
+    return(Result);
+}
+
+inline rectangle2i
+Union(rectangle2i A, rectangle2i B)
+{
+    rectangle2i Result;
+
+    Result.MinX = (A.MinX < B.MinX) ? A.MinX : B.MinX;
+    Result.MinY = (A.MinY < B.MinY) ? A.MinY : B.MinY;
+    Result.MaxX = (A.MaxX > B.MaxX) ? A.MaxX : B.MaxX;
+    Result.MaxY = (A.MaxY > B.MaxY) ? A.MaxY : B.MaxY;
+
+    return(Result);
+}
+
+inline rectangle2i
+InvertedInfinityRectangle(void)
+{
+    // NOTE(casey): Unions with anything to give that thing back
+    rectangle2i Result;
+
+    Result.MinX = Result.MinY = INT32_MAX;
+    Result.MaxX = Result.MaxY = -INT32_MAX;
+
+    return(Result);
+}
+
 //
 // NOTE(casey): Rectangle3
 //
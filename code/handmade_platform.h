@@ -17,6 +17,20 @@
   HANDMADE_SLOW:
     0 - Not slow code allowed!
     1 - Slow code welcome.
+
+  HANDMADE_AVX2:
+    0 - 4-wide SSE2 rasterization (any x64 machine)
+    1 - 8-wide AVX2 rasterization (build with -arch:AVX2 / -mavx2)
+
+  HANDMADE_INCREMENTAL_REDRAW:
+    0 - Redraw the whole backbuffer every frame
+    1 - Only redraw what changed since last frame (the platform must
+        hand back the same, untouched backbuffer every frame)
+
+  HANDMADE_PERSISTENT_SIM_REGION:
+    0 - Gather the sim region from the world and write it back every frame
+    1 - Keep the sim region from frame to frame while the camera stays
+        near where it was built, only writing back what leaves it
 */
 
 #ifdef __cplusplus
@@ -46,8 +60,20 @@ extern "C" {
 #endif
 #endif
 
+#if !defined(HANDMADE_AVX2)
+#define HANDMADE_AVX2 0
+#endif
+
 #if COMPILER_MSVC
 #include <intrin.h>
+#define CompletePreviousWritesBeforeFutureWrites _WriteBarrier()
+#define CompletePreviousReadsBeforeFutureReads _ReadBarrier()
+#else
+#include <x86intrin.h>
+// NOTE(casey): x64 doesn't reorder stores with stores or loads with loads,
+// so only the compiler has to be kept from doing it.
+#define CompletePreviousWritesBeforeFutureWrites asm volatile("" ::: "memory")
+#define CompletePreviousReadsBeforeFutureReads asm volatile("" ::: "memory")
 #endif
     
 //
@@ -86,6 +112,7 @@ typedef double real64;
 #endif
 
 #define InvalidCodePath Assert(!"InvalidCodePath");
+#define InvalidDefaultCase default: {InvalidCodePath;} break
 
 #define Kilobytes(Value) ((Value)*1024LL)
 #define Megabytes(Value) (Kilobytes(Value)*1024LL)
@@ -133,8 +160,71 @@ typedef DEBUG_PLATFORM_READ_ENTIRE_FILE(debug_platform_read_entire_file);
 #define DEBUG_PLATFORM_WRITE_ENTIRE_FILE(name) bool32 name(thread_context *Thread, char *Filename, uint32 MemorySize, void *Memory)
 typedef DEBUG_PLATFORM_WRITE_ENTIRE_FILE(debug_platform_write_entire_file);
 
+// NOTE(casey): Per-frame counts the game fills in and the platform layer
+// prints and resets once the frame is done.
+enum
+{
+    DebugCounter_EntitiesRendered,
+    DebugCounter_EntitiesCulled,
+    DebugCounter_PixelsRedrawn,
+    DebugCounter_ChunkLookups,
+    DebugCounter_ChunkProbes,
+    DebugCounter_ChunksPagedIn,
+    DebugCounter_ChunksPagedOut,
+    DebugCounter_ChunksReadAhead,
+    
+    DebugCounter_Count,
+};
+typedef struct debug_counter
+{
+    uint64 Value;
+} debug_counter;
+
+#define DEBUG_COUNT(Memory, ID, Amount) ((Memory)->Counters[DebugCounter_##ID].Value += (Amount))
+#else
+#define DEBUG_COUNT(Memory, ID, Amount)
 #endif
 
+/*
+  NOTE(casey): Multithreading services.  The platform owns the worker
+  threads; the game just hands it work and waits for it to drain.
+*/
+typedef struct platform_work_queue platform_work_queue;
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(platform_work_queue *Queue, void *Data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(platform_work_queue_callback);
+
+typedef void platform_add_entry(platform_work_queue *Queue, platform_work_queue_callback *Callback, void *Data);
+typedef void platform_complete_all_work(platform_work_queue *Queue);
+
+/*
+  NOTE(casey): Read-only file mapping.  Mappings are never released - they
+  stay valid for the life of the process.  Memory is 0 on failure.
+*/
+typedef struct platform_mapped_file
+{
+    uint64 Size;
+    void *Memory;
+} platform_mapped_file;
+
+#define PLATFORM_MAP_FILE(name) platform_mapped_file name(char *FileName)
+typedef PLATFORM_MAP_FILE(platform_map_file);
+
+/*
+  NOTE(casey): Scratch files, for data the game pages out itself.  The file
+  starts out empty and goes away when the process exits.  The handle is 0
+  on failure, and reads and writes return false if they didn't complete.
+*/
+typedef struct platform_file_handle platform_file_handle;
+
+#define PLATFORM_OPEN_SCRATCH_FILE(name) platform_file_handle *name(char *FileName)
+typedef PLATFORM_OPEN_SCRATCH_FILE(platform_open_scratch_file);
+
+#define PLATFORM_READ_FROM_FILE(name) bool32 name(platform_file_handle *Handle, uint64 Offset, uint32 Size, void *Dest)
+typedef PLATFORM_READ_FROM_FILE(platform_read_from_file);
+
+#define PLATFORM_WRITE_TO_FILE(name) bool32 name(platform_file_handle *Handle, uint64 Offset, uint32 Size, void *Source)
+typedef PLATFORM_WRITE_TO_FILE(platform_write_to_file);
+
 /*
   NOTE(casey): Services that the game provides to the platform layer.
   (this may expand in the future - sound on separate thread, etc.)
@@ -221,9 +311,41 @@ typedef struct game_memory
     uint64 TransientStorageSize;
     void *TransientStorage; // NOTE(casey): REQUIRED to be cleared to zero at startup
 
+    // NOTE(casey): The queues may be 0 on platforms that don't thread yet,
+    // in which case the game does the work itself.
+    platform_work_queue *HighPriorityQueue;
+    platform_work_queue *LowPriorityQueue;
+    platform_add_entry *PlatformAddEntry;
+    platform_complete_all_work *PlatformCompleteAllWork;
+
+    // NOTE(casey): May be 0 too, in which case assets come from loose files
+    platform_map_file *PlatformMapFile;
+
+    // NOTE(casey): And these, in which case the whole world stays resident
+    platform_open_scratch_file *PlatformOpenScratchFile;
+    platform_read_from_file *PlatformReadFromFile;
+    platform_write_to_file *PlatformWriteToFile;
+
+    // NOTE(casey): Set while the platform is holding on to a copy of game
+    // memory it may copy back in (input recording and playback), so the game
+    // knows not to throw away anything outside of memory that copy uses.
+    bool32 MemoryMayBeRestored;
+
+    // NOTE(casey): Set for the first frame after the platform has copied an
+    // older game memory back in (looped playback)
+    bool32 MemoryRestored;
+
+    // NOTE(casey): Set for the first frame after the platform reloads the
+    // game code
+    bool32 ExecutableReloaded;
+
     debug_platform_free_file_memory *DEBUGPlatformFreeFileMemory;
     debug_platform_read_entire_file *DEBUGPlatformReadEntireFile;
     debug_platform_write_entire_file *DEBUGPlatformWriteEntireFile;
+
+#if HANDMADE_INTERNAL
+    debug_counter Counters[DebugCounter_Count];
+#endif
 } game_memory;
 
 #define GAME_UPDATE_AND_RENDER(name) void name(thread_context *Thread, game_memory *Memory, game_input *Input, game_offscreen_buffer *Buffer)
@@ -244,6 +366,13 @@ inline game_controller_input *GetController(game_input *Input, int unsigned Cont
     return(Result);
 }
 
+inline bool32 WasPressed(game_button_state State)
+{
+    bool32 Result = ((State.HalfTransitionCount > 1) ||
+                     ((State.HalfTransitionCount == 1) && State.EndedDown));
+    return(Result);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,1519 @@
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Casey Muratori $
+   $Notice: (C) Copyright 2015 by Molly Rocket, Inc. All Rights Reserved. $
+   ======================================================================== */
+
+// NOTE(casey): Fills smaller than this are about to be blended on top of,
+// so they should stay in cache.  Anything bigger than the L2 can't stay
+// there anyway, so those go around the cache with non-temporal stores.
+#define STREAMING_FILL_PIXEL_COUNT (256*256)
+
+#if HANDMADE_AVX2
+#define FILL_LANE_WIDTH 8
+#define FILL_ALIGNMENT 32
+#else
+#define FILL_LANE_WIDTH 4
+#define FILL_ALIGNMENT 16
+#endif
+
+internal void
+FillRectangle(game_offscreen_buffer *Buffer, rectangle2i FillRect, uint32 Color)
+{
+    Assert(HasArea(FillRect));
+    
+    bool32 Streaming = (((FillRect.MaxX - FillRect.MinX)*(FillRect.MaxY - FillRect.MinY)) >=
+                        STREAMING_FILL_PIXEL_COUNT);
+
+#if HANDMADE_AVX2
+    __m256i Colorx8 = _mm256_set1_epi32((int32)Color);
+#else
+    __m128i Colorx4 = _mm_set1_epi32((int32)Color);
+#endif
+
+    uint8 *Row = ((uint8 *)Buffer->Memory +
+                  FillRect.MinX*Buffer->BytesPerPixel +
+                  FillRect.MinY*Buffer->Pitch);
+    for(int Y = FillRect.MinY;
+        Y < FillRect.MaxY;
+        ++Y)
+    {
+        uint32 *Pixel = (uint32 *)Row;
+        int X = FillRect.MinX;
+
+        // NOTE(casey): Pixels up to the first aligned address go one at a
+        // time, since the pitch doesn't have to be a multiple of the lane size.
+        while((X < FillRect.MaxX) && ((memory_index)Pixel & (FILL_ALIGNMENT - 1)))
+        {
+            *Pixel++ = Color;
+            ++X;
+        }
+
+        if(Streaming)
+        {
+            for(;
+                (X + FILL_LANE_WIDTH) <= FillRect.MaxX;
+                X += FILL_LANE_WIDTH)
+            {
+#if HANDMADE_AVX2
+                _mm256_stream_si256((__m256i *)Pixel, Colorx8);
+#else
+                _mm_stream_si128((__m128i *)Pixel, Colorx4);
+#endif
+                Pixel += FILL_LANE_WIDTH;
+            }
+        }
+        else
+        {
+            for(;
+                (X + FILL_LANE_WIDTH) <= FillRect.MaxX;
+                X += FILL_LANE_WIDTH)
+            {
+#if HANDMADE_AVX2
+                _mm256_store_si256((__m256i *)Pixel, Colorx8);
+#else
+                _mm_store_si128((__m128i *)Pixel, Colorx4);
+#endif
+                Pixel += FILL_LANE_WIDTH;
+            }
+        }
+
+        for(;
+            X < FillRect.MaxX;
+            ++X)
+        {
+            *Pixel++ = Color;
+        }
+        
+        Row += Buffer->Pitch;
+    }
+
+    if(Streaming)
+    {
+        // NOTE(casey): Non-temporal stores are weakly ordered, so they have to
+        // be fenced before anyone else (the blends, or another thread) reads
+        // this memory.
+        _mm_sfence();
+    }
+}
+
+internal void
+DrawRectangle(game_offscreen_buffer *Buffer, v2 vMin, v2 vMax, real32 R, real32 G, real32 B,
+              rectangle2i ClipRect)
+{    
+    rectangle2i FillRect;
+    FillRect.MinX = RoundReal32ToInt32(vMin.X);
+    FillRect.MinY = RoundReal32ToInt32(vMin.Y);
+    FillRect.MaxX = RoundReal32ToInt32(vMax.X);
+    FillRect.MaxY = RoundReal32ToInt32(vMax.Y);
+
+    FillRect = Intersect(ClipRect, FillRect);
+    if(HasArea(FillRect))
+    {
+        uint32 Color = ((RoundReal32ToUInt32(R * 255.0f) << 16) |
+                        (RoundReal32ToUInt32(G * 255.0f) << 8) |
+                        (RoundReal32ToUInt32(B * 255.0f) << 0));
+
+        FillRectangle(Buffer, FillRect, Color);
+    }
+}
+
+internal void
+ClearBuffer(game_offscreen_buffer *Buffer, v4 Color, rectangle2i ClipRect)
+{
+    // NOTE(casey): The clear always covers the whole clip rect, so there's
+    // no rounding or intersection to do - straight to the fill.
+    rectangle2i FillRect = Intersect(ClipRect, {0, 0, Buffer->Width, Buffer->Height});
+    if(HasArea(FillRect))
+    {
+        uint32 PackedColor = ((RoundReal32ToUInt32(Color.A * 255.0f) << 24) |
+                              (RoundReal32ToUInt32(Color.R * 255.0f) << 16) |
+                              (RoundReal32ToUInt32(Color.G * 255.0f) << 8) |
+                              (RoundReal32ToUInt32(Color.B * 255.0f) << 0));
+
+        FillRectangle(Buffer, FillRect, PackedColor);
+    }
+}
+
+inline uint32
+BlendPixel(uint32 Source, uint32 Dest, real32 CAlpha)
+{
+    real32 Inv255 = 1.0f / 255.0f;
+
+    real32 SA = ((real32)((Source >> 24) & 0xFF)*Inv255)*CAlpha;
+    real32 SR = (real32)((Source >> 16) & 0xFF);
+    real32 SG = (real32)((Source >> 8) & 0xFF);
+    real32 SB = (real32)((Source >> 0) & 0xFF);
+
+    real32 DA = (real32)((Dest >> 24) & 0xFF);
+    real32 DR = (real32)((Dest >> 16) & 0xFF);
+    real32 DG = (real32)((Dest >> 8) & 0xFF);
+    real32 DB = (real32)((Dest >> 0) & 0xFF);
+
+    // NOTE(casey): The source is already premultiplied by its own alpha,
+    // so only the constant alpha has to be applied here.
+    SR = SR*CAlpha;
+    SG = SG*CAlpha;
+    SB = SB*CAlpha;
+
+    // NOTE(casey): Premultiplied alpha, so each channel is a single
+    // multiply-add against the destination.
+    real32 InvSA = 1.0f - SA;
+    real32 A = 255.0f*SA + InvSA*DA;
+    real32 R = SR + InvSA*DR;
+    real32 G = SG + InvSA*DG;
+    real32 B = SB + InvSA*DB;
+
+    uint32 Result = (((uint32)(A + 0.5f) << 24) |
+                     ((uint32)(R + 0.5f) << 16) |
+                     ((uint32)(G + 0.5f) << 8) |
+                     ((uint32)(B + 0.5f) << 0));
+
+    return(Result);
+}
+
+struct bitmap_blit
+{
+    int32 MinX;
+    int32 MinY;
+    int32 MaxX;
+    int32 MaxY;
+
+    // NOTE(casey): Where MinX, MinY lands in the bitmap, with the row in
+    // memory order (so it counts down as the blit moves down the screen)
+    int32 SourceX;
+    int32 SourceY;
+
+    uint32 *SourceRow;
+    uint8 *DestRow;
+};
+
+inline bitmap_blit
+ClipBitmapBlit(game_offscreen_buffer *Buffer, loaded_bitmap *Bitmap, real32 RealX, real32 RealY,
+               rectangle2i ClipRect)
+{
+    Assert(Bitmap->Premultiplied);
+
+    bitmap_blit Result;
+
+    int32 MinX = RoundReal32ToInt32(RealX);
+    int32 MinY = RoundReal32ToInt32(RealY);
+    int32 MaxX = MinX + Bitmap->Width;
+    int32 MaxY = MinY + Bitmap->Height;
+
+    int32 SourceOffsetX = 0;
+    if(MinX < ClipRect.MinX)
+    {
+        SourceOffsetX = ClipRect.MinX - MinX;
+        MinX = ClipRect.MinX;
+    }
+
+    int32 SourceOffsetY = 0;
+    if(MinY < ClipRect.MinY)
+    {
+        SourceOffsetY = ClipRect.MinY - MinY;
+        MinY = ClipRect.MinY;
+    }
+
+    if(MaxX > ClipRect.MaxX)
+    {
+        MaxX = ClipRect.MaxX;
+    }
+
+    if(MaxY > ClipRect.MaxY)
+    {
+        MaxY = ClipRect.MaxY;
+    }
+
+    Result.MinX = MinX;
+    Result.MinY = MinY;
+    Result.MaxX = MaxX;
+    Result.MaxY = MaxY;
+
+    Result.SourceX = SourceOffsetX;
+    Result.SourceY = Bitmap->Height - 1 - SourceOffsetY;
+
+    Result.SourceRow = (uint32 *)((uint8 *)Bitmap->Pixels +
+                                  Bitmap->Pitch*(Bitmap->Height - 1 - SourceOffsetY));
+    Result.SourceRow += SourceOffsetX;
+    Result.DestRow = ((uint8 *)Buffer->Memory +
+                      MinX*Buffer->BytesPerPixel +
+                      MinY*Buffer->Pitch);
+
+    return(Result);
+}
+
+// NOTE(casey): This is the reference blitter - DrawBitmap has to match
+// it (to within rounding) on every lane width.
+internal void
+DrawBitmapSlowly(game_offscreen_buffer *Buffer, loaded_bitmap *Bitmap,
+                 real32 RealX, real32 RealY, real32 CAlpha, rectangle2i ClipRect)
+{
+    bitmap_blit Blit = ClipBitmapBlit(Buffer, Bitmap, RealX, RealY, ClipRect);
+
+    uint32 *SourceRow = Blit.SourceRow;
+    uint8 *DestRow = Blit.DestRow;
+    for(int Y = Blit.MinY;
+        Y < Blit.MaxY;
+        ++Y)
+    {
+        uint32 *Dest = (uint32 *)DestRow;
+        uint32 *Source = SourceRow;
+        for(int X = Blit.MinX;
+            X < Blit.MaxX;
+            ++X)
+        {
+            *Dest = BlendPixel(*Source, *Dest, CAlpha);
+            
+            ++Dest;
+            ++Source;
+        }
+
+        DestRow += Buffer->Pitch;
+        SourceRow = (uint32 *)((uint8 *)SourceRow - Bitmap->Pitch);
+    }
+}
+
+#if HANDMADE_AVX2
+#define BITMAP_LANE_WIDTH 8
+inline void
+BlendPixelLanes(uint32 *Source, uint32 *Dest, real32 CAlpha)
+{
+    __m256 Inv255_8x = _mm256_set1_ps(1.0f / 255.0f);
+    __m256 One_8x = _mm256_set1_ps(1.0f);
+    __m256 Half_8x = _mm256_set1_ps(0.5f);
+    __m256 Two55_8x = _mm256_set1_ps(255.0f);
+    __m256 CAlpha_8x = _mm256_set1_ps(CAlpha);
+    __m256i MaskFF = _mm256_set1_epi32(0xFF);
+
+    __m256i OriginalSource = _mm256_loadu_si256((__m256i *)Source);
+    __m256i OriginalDest = _mm256_loadu_si256((__m256i *)Dest);
+
+    __m256 SA = _mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(OriginalSource, 24)),
+                                            Inv255_8x), CAlpha_8x);
+    __m256 SR = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(OriginalSource, 16), MaskFF));
+    __m256 SG = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(OriginalSource, 8), MaskFF));
+    __m256 SB = _mm256_cvtepi32_ps(_mm256_and_si256(OriginalSource, MaskFF));
+
+    __m256 DA = _mm256_cvtepi32_ps(_mm256_srli_epi32(OriginalDest, 24));
+    __m256 DR = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(OriginalDest, 16), MaskFF));
+    __m256 DG = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(OriginalDest, 8), MaskFF));
+    __m256 DB = _mm256_cvtepi32_ps(_mm256_and_si256(OriginalDest, MaskFF));
+
+    SR = _mm256_mul_ps(SR, CAlpha_8x);
+    SG = _mm256_mul_ps(SG, CAlpha_8x);
+    SB = _mm256_mul_ps(SB, CAlpha_8x);
+
+    __m256 InvSA = _mm256_sub_ps(One_8x, SA);
+    __m256 A = _mm256_add_ps(_mm256_mul_ps(Two55_8x, SA), _mm256_mul_ps(InvSA, DA));
+    __m256 R = _mm256_add_ps(SR, _mm256_mul_ps(InvSA, DR));
+    __m256 G = _mm256_add_ps(SG, _mm256_mul_ps(InvSA, DG));
+    __m256 B = _mm256_add_ps(SB, _mm256_mul_ps(InvSA, DB));
+
+    __m256i IntA = _mm256_cvttps_epi32(_mm256_add_ps(A, Half_8x));
+    __m256i IntR = _mm256_cvttps_epi32(_mm256_add_ps(R, Half_8x));
+    __m256i IntG = _mm256_cvttps_epi32(_mm256_add_ps(G, Half_8x));
+    __m256i IntB = _mm256_cvttps_epi32(_mm256_add_ps(B, Half_8x));
+
+    __m256i Out = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(IntA, 24),
+                                                  _mm256_slli_epi32(IntR, 16)),
+                                  _mm256_or_si256(_mm256_slli_epi32(IntG, 8),
+                                                  IntB));
+
+    _mm256_storeu_si256((__m256i *)Dest, Out);
+}
+#else
+#define BITMAP_LANE_WIDTH 4
+inline void
+BlendPixelLanes(uint32 *Source, uint32 *Dest, real32 CAlpha)
+{
+    __m128 Inv255_4x = _mm_set1_ps(1.0f / 255.0f);
+    __m128 One_4x = _mm_set1_ps(1.0f);
+    __m128 Half_4x = _mm_set1_ps(0.5f);
+    __m128 Two55_4x = _mm_set1_ps(255.0f);
+    __m128 CAlpha_4x = _mm_set1_ps(CAlpha);
+    __m128i MaskFF = _mm_set1_epi32(0xFF);
+
+    __m128i OriginalSource = _mm_loadu_si128((__m128i *)Source);
+    __m128i OriginalDest = _mm_loadu_si128((__m128i *)Dest);
+
+    __m128 SA = _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(OriginalSource, 24)),
+                                      Inv255_4x), CAlpha_4x);
+    __m128 SR = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(OriginalSource, 16), MaskFF));
+    __m128 SG = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(OriginalSource, 8), MaskFF));
+    __m128 SB = _mm_cvtepi32_ps(_mm_and_si128(OriginalSource, MaskFF));
+
+    __m128 DA = _mm_cvtepi32_ps(_mm_srli_epi32(OriginalDest, 24));
+    __m128 DR = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(OriginalDest, 16), MaskFF));
+    __m128 DG = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(OriginalDest, 8), MaskFF));
+    __m128 DB = _mm_cvtepi32_ps(_mm_and_si128(OriginalDest, MaskFF));
+
+    SR = _mm_mul_ps(SR, CAlpha_4x);
+    SG = _mm_mul_ps(SG, CAlpha_4x);
+    SB = _mm_mul_ps(SB, CAlpha_4x);
+
+    __m128 InvSA = _mm_sub_ps(One_4x, SA);
+    __m128 A = _mm_add_ps(_mm_mul_ps(Two55_4x, SA), _mm_mul_ps(InvSA, DA));
+    __m128 R = _mm_add_ps(SR, _mm_mul_ps(InvSA, DR));
+    __m128 G = _mm_add_ps(SG, _mm_mul_ps(InvSA, DG));
+    __m128 B = _mm_add_ps(SB, _mm_mul_ps(InvSA, DB));
+
+    __m128i IntA = _mm_cvttps_epi32(_mm_add_ps(A, Half_4x));
+    __m128i IntR = _mm_cvttps_epi32(_mm_add_ps(R, Half_4x));
+    __m128i IntG = _mm_cvttps_epi32(_mm_add_ps(G, Half_4x));
+    __m128i IntB = _mm_cvttps_epi32(_mm_add_ps(B, Half_4x));
+
+    __m128i Out = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(IntA, 24),
+                                            _mm_slli_epi32(IntR, 16)),
+                               _mm_or_si128(_mm_slli_epi32(IntG, 8),
+                                            IntB));
+
+    _mm_storeu_si128((__m128i *)Dest, Out);
+}
+#endif
+
+inline void
+BlendRun(uint32 *Source, uint32 *Dest, int32 Count, real32 CAlpha)
+{
+    int32 Index = 0;
+    for(;
+        (Index + BITMAP_LANE_WIDTH) <= Count;
+        Index += BITMAP_LANE_WIDTH)
+    {
+        BlendPixelLanes(Source, Dest, CAlpha);
+
+        Dest += BITMAP_LANE_WIDTH;
+        Source += BITMAP_LANE_WIDTH;
+    }
+
+    // NOTE(casey): Finish off the ragged right edge one pixel at a time
+    for(;
+        Index < Count;
+        ++Index)
+    {
+        *Dest = BlendPixel(*Source, *Dest, CAlpha);
+            
+        ++Dest;
+        ++Source;
+    }
+}
+
+internal void
+BuildBitmapSpans(memory_arena *Arena, loaded_bitmap *Bitmap)
+{
+    Assert(Bitmap->Premultiplied);
+    Assert(Bitmap->Width <= 0xFFFF);
+
+    Bitmap->RowFirstSpan = PushArray(Arena, Bitmap->Height + 1, uint32);
+
+    uint32 SpanCount = 0;
+    uint32 *Row = Bitmap->Pixels;
+    for(int32 Y = 0;
+        Y < Bitmap->Height;
+        ++Y)
+    {
+        Bitmap->RowFirstSpan[Y] = SpanCount;
+        SpanCount += BuildRowSpans(Row, Bitmap->Width, 0);
+        Row = (uint32 *)((uint8 *)Row + Bitmap->Pitch);
+    }
+    Bitmap->RowFirstSpan[Bitmap->Height] = SpanCount;
+
+    Bitmap->Spans = PushArray(Arena, SpanCount, bitmap_span);
+
+    Row = Bitmap->Pixels;
+    for(int32 Y = 0;
+        Y < Bitmap->Height;
+        ++Y)
+    {
+        BuildRowSpans(Row, Bitmap->Width, Bitmap->Spans + Bitmap->RowFirstSpan[Y]);
+        Row = (uint32 *)((uint8 *)Row + Bitmap->Pitch);
+    }
+}
+
+//
+// NOTE(casey): Mip chains
+//
+
+#define MIP_ALIGNMENT 16
+
+inline memory_index
+AlignMipSize(memory_index Size)
+{
+    memory_index Result = (Size + (MIP_ALIGNMENT - 1)) & ~(memory_index)(MIP_ALIGNMENT - 1);
+    return(Result);
+}
+
+internal memory_index
+GetMipChainSize(int32 Width, int32 Height)
+{
+    // NOTE(casey): Every level below the top one, each with its
+    // loaded_bitmap stored right in front of its pixels.
+    memory_index Result = MIP_ALIGNMENT;
+    Width /= 2;
+    Height /= 2;
+    while((Width > 0) && (Height > 0))
+    {
+        Result += AlignMipSize(sizeof(loaded_bitmap));
+        Result += AlignMipSize((memory_index)Width*Height*sizeof(uint32));
+        Width /= 2;
+        Height /= 2;
+    }
+
+    return(Result);
+}
+
+internal void
+DownsampleBitmap(loaded_bitmap *Source, loaded_bitmap *Dest)
+{
+    // NOTE(casey): 2x2 box filter.  Everything is premultiplied, so each
+    // channel can just be averaged on its own without dark fringes.  An odd
+    // last row or column gets dropped.
+    uint8 *SourceRow = (uint8 *)Source->Pixels;
+    uint32 *DestPixel = Dest->Pixels;
+    for(int32 Y = 0;
+        Y < Dest->Height;
+        ++Y)
+    {
+        uint32 *Row0 = (uint32 *)SourceRow;
+        uint32 *Row1 = (uint32 *)(SourceRow + Source->Pitch);
+        for(int32 X = 0;
+            X < Dest->Width;
+            ++X)
+        {
+            uint32 C00 = Row0[2*X];
+            uint32 C10 = Row0[2*X + 1];
+            uint32 C01 = Row1[2*X];
+            uint32 C11 = Row1[2*X + 1];
+
+            uint32 Result = 0;
+            for(uint32 Shift = 0;
+                Shift < 32;
+                Shift += 8)
+            {
+                uint32 Sum = (((C00 >> Shift) & 0xFF) +
+                              ((C10 >> Shift) & 0xFF) +
+                              ((C01 >> Shift) & 0xFF) +
+                              ((C11 >> Shift) & 0xFF) + 2);
+                Result |= (Sum >> 2) << Shift;
+            }
+
+            *DestPixel++ = Result;
+        }
+
+        SourceRow += 2*Source->Pitch;
+    }
+}
+
+internal void
+BuildMipChain(loaded_bitmap *Bitmap, void *Memory)
+{
+    // NOTE(casey): Memory has to be at least GetMipChainSize bytes
+    Assert(Bitmap->Premultiplied);
+
+    uint8 *At = (uint8 *)AlignMipSize((memory_index)Memory);
+    loaded_bitmap *Level = Bitmap;
+    while(((Level->Width / 2) > 0) && ((Level->Height / 2) > 0))
+    {
+        loaded_bitmap *Mip = (loaded_bitmap *)At;
+        At += AlignMipSize(sizeof(loaded_bitmap));
+
+        Mip->Width = Level->Width / 2;
+        Mip->Height = Level->Height / 2;
+        Mip->Pitch = Mip->Width*(int32)sizeof(uint32);
+        Mip->Pixels = (uint32 *)At;
+        Mip->Premultiplied = true;
+        Mip->RowFirstSpan = 0;
+        Mip->Spans = 0;
+        Mip->NextMip = 0;
+        At += AlignMipSize((memory_index)Mip->Height*Mip->Pitch);
+
+        DownsampleBitmap(Level, Mip);
+
+        Level->NextMip = Mip;
+        Level = Mip;
+    }
+}
+
+internal void
+BuildBitmapMips(memory_arena *Arena, loaded_bitmap *Bitmap)
+{
+    void *Memory = PushSize(Arena, GetMipChainSize(Bitmap->Width, Bitmap->Height));
+    BuildMipChain(Bitmap, Memory);
+}
+
+//
+// NOTE(casey): Atlas packing
+//
+
+// NOTE(casey): Pages start on a cache line and are a whole number of
+// cache lines wide, and sub-rects start on a cache line too, so every
+// sprite row begins lane-aligned no matter where it ended up.
+#define ATLAS_ALIGN_X 16
+#define ATLAS_PAGE_ALIGNMENT (ATLAS_ALIGN_X*sizeof(uint32))
+#define ATLAS_PAGE_WIDTH 2048
+#define ATLAS_PAGE_HEIGHT 2048
+#define MAX_ATLAS_PAGE_COUNT 16
+
+struct atlas_page
+{
+    int32 Width;
+    int32 MaxHeight;
+    int32 UsedHeight;
+    uint32 *Pixels;
+};
+
+internal uint32
+LayoutBitmapAtlas(uint32 BitmapCount, loaded_bitmap **Bitmaps, atlas_page *Pages, bool32 Copy)
+{
+    // NOTE(casey): Shelf packer - each shelf is as tall as the first (and
+    // so tallest) bitmap on it.  The first pass just sizes the pages; the
+    // second one runs the exact same layout again and copies the pixels in.
+    uint32 PageCount = 0;
+    atlas_page *Page = 0;
+    int32 ShelfX = 0;
+    int32 ShelfY = 0;
+    int32 ShelfHeight = 0;
+    for(uint32 BitmapIndex = 0;
+        BitmapIndex < BitmapCount;
+        ++BitmapIndex)
+    {
+        loaded_bitmap *Bitmap = Bitmaps[BitmapIndex];
+        int32 AlignedWidth = ((Bitmap->Width + ATLAS_ALIGN_X - 1) / ATLAS_ALIGN_X)*ATLAS_ALIGN_X;
+        
+        if(Page && ((ShelfX + Bitmap->Width) > Page->Width))
+        {
+            ShelfX = 0;
+            ShelfY += ShelfHeight;
+            ShelfHeight = 0;
+        }
+
+        if(!Page || ((ShelfY + Bitmap->Height) > Page->MaxHeight) || (Bitmap->Width > Page->Width))
+        {
+            Assert(PageCount < MAX_ATLAS_PAGE_COUNT);
+            Page = Pages + PageCount++;
+            if(!Copy)
+            {
+                // NOTE(casey): Anything too big for a page gets a page to itself
+                Page->Width = Maximum(ATLAS_PAGE_WIDTH, AlignedWidth);
+                Page->MaxHeight = Maximum(ATLAS_PAGE_HEIGHT, Bitmap->Height);
+                Page->UsedHeight = 0;
+                Page->Pixels = 0;
+            }
+            
+            ShelfX = 0;
+            ShelfY = 0;
+            ShelfHeight = 0;
+        }
+
+        if(Copy)
+        {
+            uint32 *DestRow = Page->Pixels + ShelfY*Page->Width + ShelfX;
+            uint8 *SourceRow = (uint8 *)Bitmap->Pixels;
+            for(int32 Y = 0;
+                Y < Bitmap->Height;
+                ++Y)
+            {
+                uint32 *Dest = DestRow;
+                uint32 *Source = (uint32 *)SourceRow;
+                for(int32 X = 0;
+                    X < Bitmap->Width;
+                    ++X)
+                {
+                    *Dest++ = *Source++;
+                }
+
+                DestRow += Page->Width;
+                SourceRow += Bitmap->Pitch;
+            }
+
+            Bitmap->Pixels = Page->Pixels + ShelfY*Page->Width + ShelfX;
+            Bitmap->Pitch = Page->Width*(int32)sizeof(uint32);
+        }
+        else
+        {
+            Page->UsedHeight = Maximum(Page->UsedHeight, ShelfY + Bitmap->Height);
+        }
+        
+        ShelfX += AlignedWidth;
+        ShelfHeight = Maximum(ShelfHeight, Bitmap->Height);
+    }
+
+    return(PageCount);
+}
+
+internal void
+PackBitmapAtlas(memory_arena *Arena, uint32 BitmapCount, loaded_bitmap **Bitmaps)
+{
+    // NOTE(casey): Moves every bitmap's pixels into a few shared pages, so
+    // the pieces of one entity end up next to each other in memory instead
+    // of scattered across separate file reads.  Bitmaps gets sorted in place,
+    // tallest first - there are only ever a handful, so insertion sort it is.
+    for(uint32 BitmapIndex = 1;
+        BitmapIndex < BitmapCount;
+        ++BitmapIndex)
+    {
+        for(loaded_bitmap **Scan = Bitmaps + BitmapIndex;
+            (Scan > Bitmaps) && (Scan[-1]->Height < Scan[0]->Height);
+            --Scan)
+        {
+            loaded_bitmap *Swap = Scan[-1];
+            Scan[-1] = Scan[0];
+            Scan[0] = Swap;
+        }
+    }
+
+    atlas_page Pages[MAX_ATLAS_PAGE_COUNT];
+    uint32 PageCount = LayoutBitmapAtlas(BitmapCount, Bitmaps, Pages, false);
+    for(uint32 PageIndex = 0;
+        PageIndex < PageCount;
+        ++PageIndex)
+    {
+        atlas_page *Page = Pages + PageIndex;
+        Page->Pixels = PushAlignedArray(Arena, Page->Width*Page->UsedHeight, uint32, ATLAS_PAGE_ALIGNMENT);
+    }
+    LayoutBitmapAtlas(BitmapCount, Bitmaps, Pages, true);
+
+    // TODO(casey): Once there's an asset system, the file memory the
+    // bitmaps were loaded into should be freed here.
+}
+
+internal void
+DrawBitmapSpans(game_offscreen_buffer *Buffer, loaded_bitmap *Bitmap, bitmap_blit Blit,
+                real32 CAlpha)
+{
+    // NOTE(casey): Opaque pixels only come out as a straight copy when
+    // nothing is fading them.
+    bool32 CanCopy = (CAlpha == 1.0f);
+    
+    int32 SourceMinX = Blit.SourceX;
+    int32 SourceMaxX = Blit.SourceX + (Blit.MaxX - Blit.MinX);
+    
+    int32 SourceY = Blit.SourceY;
+    uint8 *DestRow = Blit.DestRow;
+    for(int Y = Blit.MinY;
+        Y < Blit.MaxY;
+        ++Y)
+    {
+        uint32 *SourceRow = (uint32 *)((uint8 *)Bitmap->Pixels + SourceY*Bitmap->Pitch);
+        uint32 *DestRowPixels = (uint32 *)DestRow - SourceMinX;
+        
+        bitmap_span *Span = Bitmap->Spans + Bitmap->RowFirstSpan[SourceY];
+        bitmap_span *OnePastLastSpan = Bitmap->Spans + Bitmap->RowFirstSpan[SourceY + 1];
+        for(;
+            Span < OnePastLastSpan;
+            ++Span)
+        {
+            int32 MinX = Maximum(SourceMinX, (int32)Span->MinX);
+            int32 MaxX = Minimum(SourceMaxX, (int32)Span->MaxX);
+            if(MinX < MaxX)
+            {
+                uint32 *Source = SourceRow + MinX;
+                uint32 *Dest = DestRowPixels + MinX;
+                int32 Count = MaxX - MinX;
+                if(CanCopy && (Span->Type == BitmapSpan_Copy))
+                {
+                    for(int32 Index = 0;
+                        Index < Count;
+                        ++Index)
+                    {
+                        *Dest++ = *Source++;
+                    }
+                }
+                else
+                {
+                    BlendRun(Source, Dest, Count, CAlpha);
+                }
+            }
+        }
+
+        DestRow += Buffer->Pitch;
+        --SourceY;
+    }
+}
+
+internal void
+DrawBitmap(game_offscreen_buffer *Buffer, loaded_bitmap *Bitmap,
+           real32 RealX, real32 RealY, real32 CAlpha, rectangle2i ClipRect)
+{
+    bitmap_blit Blit = ClipBitmapBlit(Buffer, Bitmap, RealX, RealY, ClipRect);
+
+    if(Bitmap->Spans)
+    {
+        DrawBitmapSpans(Buffer, Bitmap, Blit, CAlpha);
+    }
+    else
+    {
+        uint32 *SourceRow = Blit.SourceRow;
+        uint8 *DestRow = Blit.DestRow;
+        for(int Y = Blit.MinY;
+            Y < Blit.MaxY;
+            ++Y)
+        {
+            BlendRun(SourceRow, (uint32 *)DestRow, Blit.MaxX - Blit.MinX, CAlpha);
+
+            DestRow += Buffer->Pitch;
+            SourceRow = (uint32 *)((uint8 *)SourceRow - Bitmap->Pitch);
+        }
+    }
+}
+
+internal render_group *
+AllocateRenderGroup(memory_arena *Arena, uint32 MaxPushBufferSize, real32 MetersToPixels,
+                    real32 BitmapScale, game_assets *Assets)
+{
+    render_group *Result = PushStruct(Arena, render_group);
+    Result->Assets = Assets;
+    Result->PushBufferBase = (uint8 *)PushSize(Arena, MaxPushBufferSize);
+
+    Result->DefaultBasis = PushStruct(Arena, render_basis);
+    Result->DefaultBasis->P = V3(0, 0, 0);
+    Result->DefaultBasis->SortKey = 0;
+    Result->DefaultBasis->PieceCount = 0;
+    Result->MetersToPixels = MetersToPixels;
+
+    // NOTE(casey): Nearest in log terms, so a level is picked once the
+    // scale gets closer to its size than to the size above it.
+    Result->MipLevel = 0;
+    while(BitmapScale < 0.7071f)
+    {
+        BitmapScale *= 2.0f;
+        ++Result->MipLevel;
+    }
+
+    Result->MaxPushBufferSize = MaxPushBufferSize;
+    Result->PushBufferSize = 0;
+
+    Result->EntryCount = 0;
+    Result->SortedEntries = 0;
+
+    return(Result);
+}
+
+/* NOTE(casey): Sort keys draw in ascending order, and are packed as
+
+     63..56  Layer - chunk Z relative to the camera, biased by 128
+         55  Set for pieces that stand up off the ground (EntityZC != 0)
+     54..23  Ground Y, flipped so that things further up the screen
+             (further away) come first
+     22..5   Storage index, so ties never depend on gather order
+      4..0   Piece index within the entity, in push order
+
+   Key 0 is reserved for the clear, which always goes first.
+*/
+#define SORT_KEY_ELEVATED_BIT ((uint64)1 << 55)
+
+inline uint32
+SortableReal32(real32 Value)
+{
+    // NOTE(casey): Flip the bits so that the unsigned integer ordering
+    // matches the floating point ordering, negatives included.
+    uint32 Bits = *(uint32 *)&Value;
+    uint32 Result = (Bits & 0x80000000) ? ~Bits : (Bits | 0x80000000);
+    return(Result);
+}
+
+inline uint64
+GetEntitySortKey(int32 RelativeChunkZ, real32 GroundY, uint32 StorageIndex)
+{
+    int32 Layer = RelativeChunkZ + 128;
+    if(Layer < 1)
+    {
+        Layer = 1;
+    }
+    if(Layer > 255)
+    {
+        Layer = 255;
+    }
+
+    uint64 YKey = (uint64)(~SortableReal32(GroundY));
+    Assert(StorageIndex < (1 << 18));
+
+    uint64 Result = (((uint64)Layer << 56) |
+                     (YKey << 23) |
+                     ((uint64)(StorageIndex & ((1 << 18) - 1)) << 5));
+    return(Result);
+}
+
+#define PushRenderElement(Group, type, SortKey) (type *)PushRenderElement_(Group, sizeof(type), RenderGroupEntryType_##type, SortKey)
+inline void *
+PushRenderElement_(render_group *Group, uint32 Size, render_group_entry_type Type, uint64 SortKey)
+{
+    void *Result = 0;
+
+    Size += sizeof(render_group_entry_header);
+    if((Group->PushBufferSize + Size) <= Group->MaxPushBufferSize)
+    {
+        render_group_entry_header *Header = (render_group_entry_header *)(Group->PushBufferBase + Group->PushBufferSize);
+        Header->Type = Type;
+        Header->SortKey = SortKey;
+        Result = (uint8 *)Header + sizeof(*Header);
+        Group->PushBufferSize += Size;
+        ++Group->EntryCount;
+    }
+    else
+    {
+        InvalidCodePath;
+    }
+
+    return(Result);
+}
+
+inline uint64
+GetPieceSortKey(render_basis *Basis, real32 EntityZC)
+{
+    Assert(Basis->PieceCount < 32);
+    uint64 Result = Basis->SortKey | Basis->PieceCount++;
+    if(EntityZC != 0.0f)
+    {
+        Result |= SORT_KEY_ELEVATED_BIT;
+    }
+
+    return(Result);
+}
+
+inline void
+PushBitmap(render_group *Group, asset_bitmap_id ID,
+           v2 Offset, real32 OffsetZ, v2 Align, real32 Alpha = 1.0f, real32 EntityZC = 1.0f)
+{
+    uint64 SortKey = GetPieceSortKey(Group->DefaultBasis, EntityZC);
+    loaded_bitmap *Bitmap = GetBitmap(Group->Assets, ID);
+    if(Bitmap)
+    {
+        // NOTE(casey): Short chains just bottom out at their smallest level
+        for(uint32 MipIndex = 0;
+            (MipIndex < Group->MipLevel) && Bitmap->NextMip;
+            ++MipIndex)
+        {
+            Bitmap = Bitmap->NextMip;
+            Align *= 0.5f;
+        }
+        
+        render_entry_bitmap *Piece = PushRenderElement(Group, render_entry_bitmap, SortKey);
+        if(Piece)
+        {
+            Piece->EntityBasis.Basis = Group->DefaultBasis;
+            Piece->Bitmap = Bitmap;
+            Piece->EntityBasis.Offset = Group->MetersToPixels*V2(Offset.X, -Offset.Y) - Align;
+            Piece->EntityBasis.OffsetZ = Group->MetersToPixels*OffsetZ;
+            Piece->EntityBasis.EntityZC = EntityZC;
+            Piece->R = 1.0f;
+            Piece->G = 1.0f;
+            Piece->B = 1.0f;
+            Piece->A = Alpha;
+        }
+    }
+    else
+    {
+        // NOTE(casey): Still streaming in, so stand in a flat rectangle over
+        // exactly the pixels the bitmap will cover.  It keeps the same sort
+        // key, and the signature change repaints it when the bitmap lands.
+        // Rectangles don't blend, so it's always a solid dark grey, whatever
+        // Alpha the bitmap was going to be drawn with.
+        render_entry_rectangle *Piece = PushRenderElement(Group, render_entry_rectangle, SortKey);
+        if(Piece)
+        {
+            // NOTE(casey): Steps down the same levels the loaded path would,
+            // stopping where BuildMipChain stops, so the level (and so the
+            // size) is clamped to what the bitmap will really have
+            v2 BitmapDim = GetBitmapDim(Group->Assets, ID);
+            int32 Width = (int32)BitmapDim.X;
+            int32 Height = (int32)BitmapDim.Y;
+            for(uint32 MipIndex = 0;
+                (MipIndex < Group->MipLevel) && ((Width / 2) > 0) && ((Height / 2) > 0);
+                ++MipIndex)
+            {
+                Width /= 2;
+                Height /= 2;
+                Align *= 0.5f;
+            }
+            
+            v2 Dim = V2((real32)Width, (real32)Height);
+            Piece->EntityBasis.Basis = Group->DefaultBasis;
+            Piece->EntityBasis.Offset = (Group->MetersToPixels*V2(Offset.X, -Offset.Y) -
+                                         Align + 0.5f*Dim);
+            Piece->EntityBasis.OffsetZ = Group->MetersToPixels*OffsetZ;
+            Piece->EntityBasis.EntityZC = EntityZC;
+            Piece->R = 0.25f;
+            Piece->G = 0.25f;
+            Piece->B = 0.25f;
+            Piece->A = 1.0f;
+            Piece->Dim = (1.0f / Group->MetersToPixels)*Dim;
+        }
+    }
+}
+
+inline void
+PushRect(render_group *Group, v2 Offset, real32 OffsetZ,
+         v2 Dim, v4 Color, real32 EntityZC = 1.0f)
+{
+    render_entry_rectangle *Piece = PushRenderElement(Group, render_entry_rectangle,
+                                                      GetPieceSortKey(Group->DefaultBasis, EntityZC));
+    if(Piece)
+    {
+        Piece->EntityBasis.Basis = Group->DefaultBasis;
+        Piece->EntityBasis.Offset = Group->MetersToPixels*V2(Offset.X, -Offset.Y);
+        Piece->EntityBasis.OffsetZ = Group->MetersToPixels*OffsetZ;
+        Piece->EntityBasis.EntityZC = EntityZC;
+        Piece->R = Color.R;
+        Piece->G = Color.G;
+        Piece->B = Color.B;
+        Piece->A = Color.A;
+        Piece->Dim = Dim;
+    }
+}
+
+inline void
+Clear(render_group *Group, v4 Color)
+{
+    render_entry_clear *Entry = PushRenderElement(Group, render_entry_clear, 0);
+    if(Entry)
+    {
+        Entry->Color = Color;
+    }
+}
+
+inline v2
+GetRenderEntityBasisP(render_group *RenderGroup, render_entity_basis *EntityBasis,
+                      v2 ScreenCenter)
+{
+    v3 EntityBaseP = EntityBasis->Basis->P;
+    real32 MetersToPixels = RenderGroup->MetersToPixels;
+
+    real32 EntityGroundPointX = ScreenCenter.X + MetersToPixels*EntityBaseP.X;
+    real32 EntityGroundPointY = ScreenCenter.Y - MetersToPixels*EntityBaseP.Y;
+    real32 EntityZ = -MetersToPixels*EntityBaseP.Z;
+
+    v2 Center = {EntityGroundPointX + EntityBasis->Offset.X,
+                 EntityGroundPointY + EntityBasis->Offset.Y + EntityBasis->OffsetZ + EntityBasis->EntityZC*EntityZ};
+
+    return(Center);
+}
+
+inline uint32
+GetRenderEntrySize(render_group_entry_header *Header)
+{
+    uint32 Result = sizeof(*Header);
+    switch(Header->Type)
+    {
+        case RenderGroupEntryType_render_entry_clear:
+        {
+            Result += sizeof(render_entry_clear);
+        } break;
+
+        case RenderGroupEntryType_render_entry_bitmap:
+        {
+            Result += sizeof(render_entry_bitmap);
+        } break;
+
+        case RenderGroupEntryType_render_entry_rectangle:
+        {
+            Result += sizeof(render_entry_rectangle);
+        } break;
+
+        InvalidDefaultCase;
+    }
+
+    return(Result);
+}
+
+internal void
+RadixSort(uint32 Count, render_sort_entry *First, render_sort_entry *Temp)
+{
+    // NOTE(casey): LSD radix sort, one byte at a time, so it is stable.
+    // All eight histograms are built in a single read of the keys, and any
+    // byte that is the same for every key gets skipped entirely.
+    uint32 Histograms[8][256] = {};
+    for(uint32 Index = 0;
+        Index < Count;
+        ++Index)
+    {
+        uint64 Key = First[Index].SortKey;
+        for(uint32 ByteIndex = 0;
+            ByteIndex < 8;
+            ++ByteIndex)
+        {
+            ++Histograms[ByteIndex][(Key >> (8*ByteIndex)) & 0xFF];
+        }
+    }
+
+    render_sort_entry *Source = First;
+    render_sort_entry *Dest = Temp;
+    for(uint32 ByteIndex = 0;
+        ByteIndex < 8;
+        ++ByteIndex)
+    {
+        uint32 *Histogram = Histograms[ByteIndex];
+        uint32 Shift = 8*ByteIndex;
+
+        bool32 AllSame = (Histogram[(Source[0].SortKey >> Shift) & 0xFF] == Count);
+        if(!AllSame)
+        {
+            // NOTE(casey): Turn the counts into starting offsets
+            uint32 Total = 0;
+            for(uint32 Bucket = 0;
+                Bucket < 256;
+                ++Bucket)
+            {
+                uint32 BucketCount = Histogram[Bucket];
+                Histogram[Bucket] = Total;
+                Total += BucketCount;
+            }
+
+            for(uint32 Index = 0;
+                Index < Count;
+                ++Index)
+            {
+                uint32 Bucket = (uint32)((Source[Index].SortKey >> Shift) & 0xFF);
+                Dest[Histogram[Bucket]++] = Source[Index];
+            }
+
+            render_sort_entry *Swap = Source;
+            Source = Dest;
+            Dest = Swap;
+        }
+    }
+
+    if(Source != First)
+    {
+        for(uint32 Index = 0;
+            Index < Count;
+            ++Index)
+        {
+            First[Index] = Source[Index];
+        }
+    }
+}
+
+internal void
+SortRenderGroup(render_group *RenderGroup, memory_arena *TempArena)
+{
+    uint32 Count = RenderGroup->EntryCount;
+    render_sort_entry *Entries = PushArray(TempArena, Count, render_sort_entry);
+    render_sort_entry *Temp = PushArray(TempArena, Count, render_sort_entry);
+
+    uint32 EntryIndex = 0;
+    for(uint32 BaseAddress = 0;
+        BaseAddress < RenderGroup->PushBufferSize;
+        )
+    {
+        render_group_entry_header *Header = (render_group_entry_header *)
+            (RenderGroup->PushBufferBase + BaseAddress);
+
+        render_sort_entry *Entry = Entries + EntryIndex++;
+        Entry->SortKey = Header->SortKey;
+        Entry->PushBufferOffset = BaseAddress;
+
+        BaseAddress += GetRenderEntrySize(Header);
+    }
+    Assert(EntryIndex == Count);
+
+    if(Count)
+    {
+        RadixSort(Count, Entries, Temp);
+    }
+
+    RenderGroup->SortedEntries = Entries;
+}
+
+internal void
+RenderGroupToOutput(render_group *RenderGroup, game_offscreen_buffer *OutputTarget,
+                    rectangle2i ClipRect)
+{
+    Assert(RenderGroup->SortedEntries || (RenderGroup->EntryCount == 0));
+
+    v2 ScreenCenter = {0.5f*(real32)OutputTarget->Width,
+                       0.5f*(real32)OutputTarget->Height};
+
+    for(uint32 SortIndex = 0;
+        SortIndex < RenderGroup->EntryCount;
+        ++SortIndex)
+    {
+        render_group_entry_header *Header = (render_group_entry_header *)
+            (RenderGroup->PushBufferBase + RenderGroup->SortedEntries[SortIndex].PushBufferOffset);
+        
+        void *Data = (uint8 *)Header + sizeof(*Header);
+        switch(Header->Type)
+        {
+            case RenderGroupEntryType_render_entry_clear:
+            {
+                render_entry_clear *Entry = (render_entry_clear *)Data;
+
+                ClearBuffer(OutputTarget, Entry->Color, ClipRect);
+            } break;
+
+            case RenderGroupEntryType_render_entry_bitmap:
+            {
+                render_entry_bitmap *Entry = (render_entry_bitmap *)Data;
+
+                v2 P = GetRenderEntityBasisP(RenderGroup, &Entry->EntityBasis, ScreenCenter);
+                Assert(Entry->Bitmap);
+                DrawBitmap(OutputTarget, Entry->Bitmap, P.X, P.Y, Entry->A, ClipRect);
+            } break;
+
+            case RenderGroupEntryType_render_entry_rectangle:
+            {
+                render_entry_rectangle *Entry = (render_entry_rectangle *)Data;
+
+                v2 P = GetRenderEntityBasisP(RenderGroup, &Entry->EntityBasis, ScreenCenter);
+                v2 HalfDim = 0.5f*RenderGroup->MetersToPixels*Entry->Dim;
+                DrawRectangle(OutputTarget, P - HalfDim, P + HalfDim,
+                              Entry->R, Entry->G, Entry->B, ClipRect);
+            } break;
+
+            InvalidDefaultCase;
+        }
+    }
+}
+
+struct tile_render_work
+{
+    render_group *RenderGroup;
+    game_offscreen_buffer *OutputTarget;
+    rectangle2i ClipRect;
+};
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(DoTiledRenderWork)
+{
+    tile_render_work *Work = (tile_render_work *)Data;
+
+    RenderGroupToOutput(Work->RenderGroup, Work->OutputTarget, Work->ClipRect);
+}
+
+internal void
+TiledRenderGroupToOutput(platform_work_queue *RenderQueue, platform_add_entry *AddEntry,
+                         platform_complete_all_work *CompleteAllWork,
+                         render_group *RenderGroup, game_offscreen_buffer *OutputTarget,
+                         memory_arena *TempArena)
+{
+    // NOTE(casey): Sort once up front - every tile walks the same order
+    SortRenderGroup(RenderGroup, TempArena);
+
+    // TODO(casey): Make the tile count depend on the core count and the
+    // output size, instead of just picking numbers!
+    int const TileCountX = 4;
+    int const TileCountY = 4;
+    tile_render_work WorkArray[TileCountX*TileCountY];
+
+    // NOTE(casey): Tile widths are rounded up to a whole cache line of
+    // pixels (16) so that no two cores ever write into the same line.
+    int TileWidth = OutputTarget->Width / TileCountX;
+    int TileHeight = OutputTarget->Height / TileCountY;
+    TileWidth = ((TileWidth + 15) / 16) * 16;
+
+    int WorkCount = 0;
+    for(int TileY = 0;
+        TileY < TileCountY;
+        ++TileY)
+    {
+        for(int TileX = 0;
+            TileX < TileCountX;
+            ++TileX)
+        {
+            tile_render_work *Work = WorkArray + WorkCount++;
+
+            rectangle2i ClipRect;
+            ClipRect.MinX = TileX*TileWidth;
+            ClipRect.MaxX = ClipRect.MinX + TileWidth;
+            ClipRect.MinY = TileY*TileHeight;
+            ClipRect.MaxY = ClipRect.MinY + TileHeight;
+
+            // NOTE(casey): The last row and column soak up whatever is
+            // left over from the division.
+            if(TileX == (TileCountX - 1))
+            {
+                ClipRect.MaxX = OutputTarget->Width;
+            }
+            if(TileY == (TileCountY - 1))
+            {
+                ClipRect.MaxY = OutputTarget->Height;
+            }
+            if(ClipRect.MaxX > OutputTarget->Width)
+            {
+                ClipRect.MaxX = OutputTarget->Width;
+            }
+
+            Work->RenderGroup = RenderGroup;
+            Work->OutputTarget = OutputTarget;
+            Work->ClipRect = ClipRect;
+
+            if(RenderQueue)
+            {
+                AddEntry(RenderQueue, DoTiledRenderWork, Work);
+            }
+            else
+            {
+                DoTiledRenderWork(0, Work);
+            }
+        }
+    }
+
+    if(RenderQueue)
+    {
+        CompleteAllWork(RenderQueue);
+    }
+}
+
+//
+// NOTE(casey): Incremental redraw
+//
+
+inline uint32
+MixSignature(uint32 Signature, uint32 Value)
+{
+    // NOTE(casey): FNV-1a, a word at a time
+    uint32 Result = (Signature ^ Value)*16777619;
+    return(Result);
+}
+
+inline uint32
+MixSignature(uint32 Signature, real32 Value)
+{
+    uint32 Result = MixSignature(Signature, *(uint32 *)&Value);
+    return(Result);
+}
+
+internal rectangle2i
+GetPushedScreenBounds(render_group *RenderGroup, uint32 FirstPushBufferOffset,
+                      game_offscreen_buffer *OutputTarget, uint32 *Signature)
+{
+    // NOTE(casey): Works out exactly which pixels the entries pushed since
+    // FirstPushBufferOffset will touch, using the same rounding as the
+    // rasterizers, and a signature of everything that decides what those
+    // pixels come out as.  If neither changes, neither do the pixels.
+    v2 ScreenCenter = {0.5f*(real32)OutputTarget->Width,
+                       0.5f*(real32)OutputTarget->Height};
+    
+    rectangle2i Result = InvertedInfinityRectangle();
+    uint32 Hash = 2166136261;
+    for(uint32 BaseAddress = FirstPushBufferOffset;
+        BaseAddress < RenderGroup->PushBufferSize;
+        )
+    {
+        render_group_entry_header *Header = (render_group_entry_header *)
+            (RenderGroup->PushBufferBase + BaseAddress);
+        void *Data = (uint8 *)Header + sizeof(*Header);
+
+        Hash = MixSignature(Hash, (uint32)Header->Type);
+        Hash = MixSignature(Hash, (uint32)(Header->SortKey >> 32));
+        Hash = MixSignature(Hash, (uint32)Header->SortKey);
+        
+        rectangle2i Bounds = InvertedInfinityRectangle();
+        switch(Header->Type)
+        {
+            case RenderGroupEntryType_render_entry_bitmap:
+            {
+                render_entry_bitmap *Entry = (render_entry_bitmap *)Data;
+
+                v2 P = GetRenderEntityBasisP(RenderGroup, &Entry->EntityBasis, ScreenCenter);
+                Bounds.MinX = RoundReal32ToInt32(P.X);
+                Bounds.MinY = RoundReal32ToInt32(P.Y);
+                Bounds.MaxX = Bounds.MinX + Entry->Bitmap->Width;
+                Bounds.MaxY = Bounds.MinY + Entry->Bitmap->Height;
+
+                Hash = MixSignature(Hash, (uint32)(memory_index)Entry->Bitmap);
+                Hash = MixSignature(Hash, Entry->A);
+            } break;
+
+            case RenderGroupEntryType_render_entry_rectangle:
+            {
+                render_entry_rectangle *Entry = (render_entry_rectangle *)Data;
+
+                v2 P = GetRenderEntityBasisP(RenderGroup, &Entry->EntityBasis, ScreenCenter);
+                v2 HalfDim = 0.5f*RenderGroup->MetersToPixels*Entry->Dim;
+                Bounds.MinX = RoundReal32ToInt32(P.X - HalfDim.X);
+                Bounds.MinY = RoundReal32ToInt32(P.Y - HalfDim.Y);
+                Bounds.MaxX = RoundReal32ToInt32(P.X + HalfDim.X);
+                Bounds.MaxY = RoundReal32ToInt32(P.Y + HalfDim.Y);
+
+                Hash = MixSignature(Hash, Entry->R);
+                Hash = MixSignature(Hash, Entry->G);
+                Hash = MixSignature(Hash, Entry->B);
+            } break;
+
+            // NOTE(casey): Clears belong to the whole frame, not to an entity
+            InvalidDefaultCase;
+        }
+
+        Hash = MixSignature(Hash, (uint32)Bounds.MinX);
+        Hash = MixSignature(Hash, (uint32)Bounds.MinY);
+        Hash = MixSignature(Hash, (uint32)Bounds.MaxX);
+        Hash = MixSignature(Hash, (uint32)Bounds.MaxY);
+        
+        Result = Union(Result, Bounds);
+        BaseAddress += GetRenderEntrySize(Header);
+    }
+
+    if(!HasArea(Result))
+    {
+        Result = {};
+    }
+    
+    *Signature = Hash;
+    return(Result);
+}
+
+internal dirty_grid *
+AllocateDirtyGrid(memory_arena *Arena, int32 Width, int32 Height)
+{
+    dirty_grid *Grid = PushStruct(Arena, dirty_grid);
+    Grid->AllDirty = false;
+    Grid->Width = Width;
+    Grid->Height = Height;
+    Grid->CellCountX = (Width + DIRTY_CELL_DIM - 1) / DIRTY_CELL_DIM;
+    Grid->CellCountY = (Height + DIRTY_CELL_DIM - 1) / DIRTY_CELL_DIM;
+    
+    uint32 CellCount = Grid->CellCountX*Grid->CellCountY;
+    Grid->Cells = PushArray(Arena, CellCount, uint8);
+    for(uint32 CellIndex = 0;
+        CellIndex < CellCount;
+        ++CellIndex)
+    {
+        Grid->Cells[CellIndex] = 0;
+    }
+
+    return(Grid);
+}
+
+internal void
+MarkDirty(dirty_grid *Grid, rectangle2i Rect)
+{
+    Rect = Intersect(Rect, {0, 0, Grid->Width, Grid->Height});
+    if(!Grid->AllDirty && HasArea(Rect))
+    {
+        int32 MinCellX = Rect.MinX / DIRTY_CELL_DIM;
+        int32 MinCellY = Rect.MinY / DIRTY_CELL_DIM;
+        int32 MaxCellX = (Rect.MaxX - 1) / DIRTY_CELL_DIM;
+        int32 MaxCellY = (Rect.MaxY - 1) / DIRTY_CELL_DIM;
+        for(int32 CellY = MinCellY;
+            CellY <= MaxCellY;
+            ++CellY)
+        {
+            uint8 *Cell = Grid->Cells + CellY*Grid->CellCountX + MinCellX;
+            for(int32 CellX = MinCellX;
+                CellX <= MaxCellX;
+                ++CellX)
+            {
+                *Cell++ = 1;
+            }
+        }
+    }
+}
+
+struct dirty_render_work
+{
+    render_group *RenderGroup;
+    game_offscreen_buffer *OutputTarget;
+    uint32 RectCount;
+    rectangle2i *Rects;
+};
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(DoDirtyRenderWork)
+{
+    dirty_render_work *Work = (dirty_render_work *)Data;
+
+    for(uint32 RectIndex = 0;
+        RectIndex < Work->RectCount;
+        ++RectIndex)
+    {
+        RenderGroupToOutput(Work->RenderGroup, Work->OutputTarget, Work->Rects[RectIndex]);
+    }
+}
+
+internal uint32
+IncrementalRenderGroupToOutput(platform_work_queue *RenderQueue, platform_add_entry *AddEntry,
+                               platform_complete_all_work *CompleteAllWork,
+                               render_group *RenderGroup, game_offscreen_buffer *OutputTarget,
+                               dirty_grid *Grid, memory_arena *TempArena)
+{
+    // NOTE(casey): Returns how many pixels were actually redrawn
+    uint32 Result = 0;
+    
+    if(Grid->AllDirty)
+    {
+        TiledRenderGroupToOutput(RenderQueue, AddEntry, CompleteAllWork,
+                                 RenderGroup, OutputTarget, TempArena);
+        Result = OutputTarget->Width*OutputTarget->Height;
+    }
+    else
+    {
+        SortRenderGroup(RenderGroup, TempArena);
+
+        // NOTE(casey): Each row of cells turns into one rect per run of
+        // dirty cells.
+        uint32 MaxRectCount = ((Grid->CellCountX + 1) / 2)*Grid->CellCountY;
+        rectangle2i *Rects = PushArray(TempArena, MaxRectCount, rectangle2i);
+        uint32 RectCount = 0;
+        for(int32 CellY = 0;
+            CellY < Grid->CellCountY;
+            ++CellY)
+        {
+            uint8 *Row = Grid->Cells + CellY*Grid->CellCountX;
+            int32 CellX = 0;
+            while(CellX < Grid->CellCountX)
+            {
+                if(Row[CellX])
+                {
+                    int32 RunMinX = CellX;
+                    while((CellX < Grid->CellCountX) && Row[CellX])
+                    {
+                        ++CellX;
+                    }
+
+                    rectangle2i Rect;
+                    Rect.MinX = RunMinX*DIRTY_CELL_DIM;
+                    Rect.MinY = CellY*DIRTY_CELL_DIM;
+                    Rect.MaxX = CellX*DIRTY_CELL_DIM;
+                    Rect.MaxY = Rect.MinY + DIRTY_CELL_DIM;
+                    Rect = Intersect(Rect, {0, 0, OutputTarget->Width, OutputTarget->Height});
+                    
+                    Assert(RectCount < MaxRectCount);
+                    Rects[RectCount++] = Rect;
+                    Result += (Rect.MaxX - Rect.MinX)*(Rect.MaxY - Rect.MinY);
+                }
+                else
+                {
+                    ++CellX;
+                }
+            }
+        }
+
+        // NOTE(casey): Hand the rects out to the same number of workers the
+        // tiled path uses, in contiguous batches.
+        uint32 const MaxWorkCount = 16;
+        dirty_render_work WorkArray[MaxWorkCount];
+        uint32 WorkCount = (RectCount < MaxWorkCount) ? RectCount : MaxWorkCount;
+        uint32 RectIndex = 0;
+        for(uint32 WorkIndex = 0;
+            WorkIndex < WorkCount;
+            ++WorkIndex)
+        {
+            uint32 OnePastLastRect = (RectCount*(WorkIndex + 1)) / WorkCount;
+            
+            dirty_render_work *Work = WorkArray + WorkIndex;
+            Work->RenderGroup = RenderGroup;
+            Work->OutputTarget = OutputTarget;
+            Work->Rects = Rects + RectIndex;
+            Work->RectCount = OnePastLastRect - RectIndex;
+            RectIndex = OnePastLastRect;
+
+            if(RenderQueue)
+            {
+                AddEntry(RenderQueue, DoDirtyRenderWork, Work);
+            }
+            else
+            {
+                DoDirtyRenderWork(0, Work);
+            }
+        }
+        Assert(RectIndex == RectCount);
+
+        if(RenderQueue)
+        {
+            CompleteAllWork(RenderQueue);
+        }
+    }
+
+    return(Result);
+}
@@ -0,0 +1,133 @@
+#if !defined(HANDMADE_RENDER_GROUP_H)
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Casey Muratori $
+   $Notice: (C) Copyright 2015 by Molly Rocket, Inc. All Rights Reserved. $
+   ======================================================================== */
+
+struct loaded_bitmap
+{
+    int32 Width;
+    int32 Height;
+    // NOTE(casey): In bytes - once packed into an atlas, this is the
+    // atlas page's pitch, not the bitmap's.
+    int32 Pitch;
+    uint32 *Pixels;
+
+    // NOTE(casey): Set once the color channels have been multiplied
+    // by alpha - the blitters only accept premultiplied bitmaps.
+    bool32 Premultiplied;
+
+    // NOTE(casey): Optional - built by BuildBitmapSpans.  Row Y (in memory
+    // order, so bottom-up) owns Spans[RowFirstSpan[Y]] up to
+    // Spans[RowFirstSpan[Y + 1]].
+    uint32 *RowFirstSpan;
+    bitmap_span *Spans;
+
+    // NOTE(casey): Optional - built by BuildMipChain.  Each level is half
+    // the size of the one before it, and has no spans of its own.
+    loaded_bitmap *NextMip;
+};
+
+struct render_basis
+{
+    v3 P;
+
+    // NOTE(casey): Layer, ground Y and storage index, already packed -
+    // see GetEntitySortKey.  The pieces pushed against this basis fill
+    // in the low bits in the order they were pushed.
+    uint64 SortKey;
+    uint32 PieceCount;
+};
+
+struct render_entity_basis
+{
+    render_basis *Basis;
+    v2 Offset;
+    real32 OffsetZ;
+    real32 EntityZC;
+};
+
+// NOTE(casey): render_group_entry is a "compact discriminated union"
+enum render_group_entry_type
+{
+    RenderGroupEntryType_render_entry_clear,
+    RenderGroupEntryType_render_entry_bitmap,
+    RenderGroupEntryType_render_entry_rectangle,
+};
+struct render_group_entry_header
+{
+    render_group_entry_type Type;
+
+    // NOTE(casey): Entries are drawn in ascending SortKey order
+    uint64 SortKey;
+};
+
+struct render_entry_clear
+{
+    v4 Color;
+};
+
+struct render_entry_bitmap
+{
+    render_entity_basis EntityBasis;
+    loaded_bitmap *Bitmap;
+    real32 R, G, B, A;
+};
+
+struct render_entry_rectangle
+{
+    render_entity_basis EntityBasis;
+    real32 R, G, B, A;
+    v2 Dim;
+};
+
+// NOTE(casey): The whole frame is recorded into one render group after
+// the sim has run, and only rasterized at the very end, so sorting,
+// culling and splitting the output across cores all happen in one pass.
+struct render_sort_entry
+{
+    uint64 SortKey;
+    uint32 PushBufferOffset;
+};
+
+// NOTE(casey): Incremental redraw cuts the screen into cells, and only the
+// cells something changed in since last frame get cleared and redrawn.
+#define DIRTY_CELL_DIM 32
+struct dirty_grid
+{
+    bool32 AllDirty;
+    
+    int32 Width;
+    int32 Height;
+    int32 CellCountX;
+    int32 CellCountY;
+    uint8 *Cells;
+};
+
+struct game_assets;
+struct render_group
+{
+    game_assets *Assets;
+    
+    render_basis *DefaultBasis;
+    real32 MetersToPixels;
+
+    // NOTE(casey): Bitmaps are never scaled when drawn - instead the mip
+    // level nearest to the scale they should come out at gets drawn 1:1.
+    uint32 MipLevel;
+
+    uint32 MaxPushBufferSize;
+    uint32 PushBufferSize;
+    uint8 *PushBufferBase;
+
+    uint32 EntryCount;
+
+    // NOTE(casey): Only valid after SortRenderGroup
+    render_sort_entry *SortedEntries;
+};
+
+#define HANDMADE_RENDER_GROUP_H
+#endif
@@ -15,14 +15,23 @@ GetHashFromStorageIndex(sim_region *SimRegion, uint32 StorageIndex)
     
     sim_entity_hash *Result = 0;
     
+    sim_entity_hash_table *Hash = SimRegion->Hash;
     uint32 HashValue = StorageIndex;
     for(uint32 Offset = 0;
-        Offset < ArrayCount(SimRegion->Hash);
+        Offset < ArrayCount(Hash->Entries);
         ++Offset)
     {
-        uint32 HashMask = (ArrayCount(SimRegion->Hash) - 1);
+        uint32 HashMask = (ArrayCount(Hash->Entries) - 1);
         uint32 HashIndex = ((HashValue + Offset) & HashMask);
-        sim_entity_hash *Entry = SimRegion->Hash + HashIndex;
+        sim_entity_hash *Entry = Hash->Entries + HashIndex;
+        if(Entry->Generation != Hash->Generation)
+        {
+            // NOTE(casey): Left over from an older region, so it's empty
+            Entry->Ptr = 0;
+            Entry->Index = 0;
+            Entry->Generation = Hash->Generation;
+        }
+        
         if((Entry->Index == 0) || (Entry->Index == StorageIndex))
         {
             Result = Entry;
@@ -33,6 +42,19 @@ GetHashFromStorageIndex(sim_region *SimRegion, uint32 StorageIndex)
     return(Result);
 }
 
+internal void
+ClearSimEntityHash(sim_entity_hash_table *Hash)
+{
+    ++Hash->Generation;
+    if(Hash->Generation == 0)
+    {
+        // NOTE(casey): Wrapped, so old stamps could come back around and
+        // look current.  Actually clear it, once every four billion regions.
+        ZeroStruct(Hash->Entries);
+        Hash->Generation = 1;
+    }
+}
+
 inline sim_entity *
 GetEntityByStorageIndex(sim_region *SimRegion, uint32 StorageIndex)
 {
@@ -57,6 +79,206 @@ GetSimSpaceP(sim_region *SimRegion, low_entity *Stored)
     return(Result);
 }
 
+inline void
+SetSimSweepEntry(sim_region *SimRegion, uint32 SweepIndex, sim_entity *Entity)
+{
+    sim_sweep_entry *Entry = SimRegion->SweepEntries + SweepIndex;
+    Entry->Entity = Entity;
+    Entry->MinX = Entity->P.X - 0.5f*Entity->Dim.X;
+    Entry->MaxX = Entity->P.X + 0.5f*Entity->Dim.X;
+    Entry->MinY = Entity->P.Y - 0.5f*Entity->Dim.Y;
+    Entry->MaxY = Entity->P.Y + 0.5f*Entity->Dim.Y;
+    Entity->SweepIndex = SweepIndex;
+
+    if(SimRegion->SweepMaxDimX < Entity->Dim.X)
+    {
+        SimRegion->SweepMaxDimX = Entity->Dim.X;
+    }
+}
+
+inline void
+SwapSimSweepEntries(sim_region *SimRegion, uint32 IndexA, uint32 IndexB)
+{
+    sim_sweep_entry *A = SimRegion->SweepEntries + IndexA;
+    sim_sweep_entry *B = SimRegion->SweepEntries + IndexB;
+    sim_sweep_entry Temp = *A;
+    *A = *B;
+    *B = Temp;
+    A->Entity->SweepIndex = IndexA;
+    B->Entity->SweepIndex = IndexB;
+}
+
+internal void
+AppendToSimSweep(sim_region *SimRegion, sim_entity *Entity)
+{
+    // NOTE(casey): Only for filling the sweep in BeginSim, which sorts it
+    // all at once when it's done.
+    if(!IsSet(Entity, EntityFlag_Nonspatial))
+    {
+        Assert(SimRegion->SweepCount < SimRegion->MaxEntityCount);
+        SetSimSweepEntry(SimRegion, SimRegion->SweepCount++, Entity);
+    }
+}
+
+internal void
+SortSimSweep(sim_region *SimRegion, sim_sweep_entry *Temp)
+{
+    // NOTE(casey): Bottom-up merge sort on MinX
+    uint32 Count = SimRegion->SweepCount;
+    sim_sweep_entry *Source = SimRegion->SweepEntries;
+    sim_sweep_entry *Dest = Temp;
+    for(uint32 RunLength = 1;
+        RunLength < Count;
+        RunLength *= 2)
+    {
+        for(uint32 RunStart = 0;
+            RunStart < Count;
+            RunStart += 2*RunLength)
+        {
+            uint32 Mid = Minimum(RunStart + RunLength, Count);
+            uint32 End = Minimum(RunStart + 2*RunLength, Count);
+            uint32 ReadA = RunStart;
+            uint32 ReadB = Mid;
+            for(uint32 Write = RunStart;
+                Write < End;
+                ++Write)
+            {
+                if((ReadB >= End) ||
+                   ((ReadA < Mid) && (Source[ReadA].MinX <= Source[ReadB].MinX)))
+                {
+                    Dest[Write] = Source[ReadA++];
+                }
+                else
+                {
+                    Dest[Write] = Source[ReadB++];
+                }
+            }
+        }
+
+        sim_sweep_entry *Swap = Source;
+        Source = Dest;
+        Dest = Swap;
+    }
+
+    for(uint32 SweepIndex = 0;
+        SweepIndex < Count;
+        ++SweepIndex)
+    {
+        SimRegion->SweepEntries[SweepIndex] = Source[SweepIndex];
+        SimRegion->SweepEntries[SweepIndex].Entity->SweepIndex = SweepIndex;
+    }
+}
+
+internal void
+UpdateSimSweep(sim_region *SimRegion, sim_entity *Entity)
+{
+    if(IsSet(Entity, EntityFlag_Nonspatial))
+    {
+        if(Entity->SweepIndex != SIM_SWEEP_NO_ENTRY)
+        {
+            for(uint32 SweepIndex = Entity->SweepIndex + 1;
+                SweepIndex < SimRegion->SweepCount;
+                ++SweepIndex)
+            {
+                SimRegion->SweepEntries[SweepIndex - 1] = SimRegion->SweepEntries[SweepIndex];
+                SimRegion->SweepEntries[SweepIndex - 1].Entity->SweepIndex = SweepIndex - 1;
+            }
+            --SimRegion->SweepCount;
+            Entity->SweepIndex = SIM_SWEEP_NO_ENTRY;
+        }
+    }
+    else
+    {
+        uint32 SweepIndex = Entity->SweepIndex;
+        if(SweepIndex == SIM_SWEEP_NO_ENTRY)
+        {
+            Assert(SimRegion->SweepCount < SimRegion->MaxEntityCount);
+            SweepIndex = SimRegion->SweepCount++;
+        }
+        SetSimSweepEntry(SimRegion, SweepIndex, Entity);
+
+        // NOTE(casey): Things only move a little per update, so one pass of
+        // insertion sort in whichever direction it went puts it back in order,
+        // usually in a swap or two.
+        sim_sweep_entry *Entries = SimRegion->SweepEntries;
+        while((SweepIndex > 0) &&
+              (Entries[SweepIndex - 1].MinX > Entries[SweepIndex].MinX))
+        {
+            SwapSimSweepEntries(SimRegion, SweepIndex - 1, SweepIndex);
+            --SweepIndex;
+        }
+        while(((SweepIndex + 1) < SimRegion->SweepCount) &&
+              (Entries[SweepIndex + 1].MinX < Entries[SweepIndex].MinX))
+        {
+            SwapSimSweepEntries(SimRegion, SweepIndex, SweepIndex + 1);
+            ++SweepIndex;
+        }
+    }
+}
+
+internal uint32
+GatherSimSweepCandidates(sim_region *SimRegion, rectangle2 Query)
+{
+    sim_sweep_entry *Entries = SimRegion->SweepEntries;
+
+    // NOTE(casey): Nothing wider than SweepMaxDimX can start further left
+    // than this and still reach the query.
+    real32 FirstMinX = Query.Min.X - SimRegion->SweepMaxDimX;
+    uint32 First = 0;
+    uint32 OnePastLast = SimRegion->SweepCount;
+    while(First < OnePastLast)
+    {
+        uint32 Mid = First + (OnePastLast - First) / 2;
+        if(Entries[Mid].MinX < FirstMinX)
+        {
+            First = Mid + 1;
+        }
+        else
+        {
+            OnePastLast = Mid;
+        }
+    }
+
+    // NOTE(casey): Candidates are marked in a bitmap by entity index and then
+    // read back out in order, so callers see them in exactly the order a
+    // walk of the whole entity array would.
+    uint32 *Bits = SimRegion->CandidateBits;
+    uint32 MinWord = (SimRegion->MaxEntityCount + 31) / 32;
+    uint32 MaxWord = 0;
+    for(uint32 SweepIndex = First;
+        (SweepIndex < SimRegion->SweepCount) && (Entries[SweepIndex].MinX <= Query.Max.X);
+        ++SweepIndex)
+    {
+        sim_sweep_entry *Entry = Entries + SweepIndex;
+        if((Entry->MaxX >= Query.Min.X) &&
+           (Entry->MinY <= Query.Max.Y) &&
+           (Entry->MaxY >= Query.Min.Y))
+        {
+            uint32 EntityIndex = (uint32)(Entry->Entity - SimRegion->Entities);
+            uint32 Word = EntityIndex / 32;
+            Bits[Word] |= ((uint32)1 << (EntityIndex % 32));
+            MinWord = Minimum(MinWord, Word);
+            MaxWord = Maximum(MaxWord, Word);
+        }
+    }
+
+    uint32 Count = 0;
+    for(uint32 Word = MinWord;
+        Word <= MaxWord;
+        ++Word)
+    {
+        while(Bits[Word])
+        {
+            bit_scan_result Scan = FindLeastSignificantSetBit(Bits[Word]);
+            Assert(Scan.Found);
+            Bits[Word] &= ~((uint32)1 << Scan.Index);
+            SimRegion->Candidates[Count++] = SimRegion->Entities + (Word*32 + Scan.Index);
+        }
+    }
+
+    return(Count);
+}
+
 internal sim_entity *
 AddEntity(game_state *GameState, sim_region *SimRegion, uint32 StorageIndex, low_entity *Source, v3 *SimP);
 inline void
@@ -67,10 +289,16 @@ LoadEntityReference(game_state *GameState, sim_region *SimRegion, entity_referen
         sim_entity_hash *Entry = GetHashFromStorageIndex(SimRegion, Ref->Index);
         if(Entry->Ptr == 0)
         {
-            Entry->Index = Ref->Index;
+            // NOTE(casey): If the entity's chunk is paged out, the reference
+            // just doesn't resolve this frame.  Ptr stays 0, so
+            // StoreEntityReference leaves the index alone.
             low_entity *LowEntity = GetLowEntity(GameState, Ref->Index);
-            v3 P = GetSimSpaceP(SimRegion, LowEntity);
-            Entry->Ptr = AddEntity(GameState, SimRegion, Ref->Index, LowEntity, &P);
+            if(LowEntity)
+            {
+                Entry->Index = Ref->Index;
+                v3 P = GetSimSpaceP(SimRegion, LowEntity);
+                Entry->Ptr = AddEntity(GameState, SimRegion, Ref->Index, LowEntity, &P);
+            }
         }
         
         Ref->Ptr = Entry->Ptr;
@@ -115,6 +343,7 @@ AddEntityRaw(game_state *GameState, sim_region *SimRegion, uint32 StorageIndex,
 
             Entity->StorageIndex = StorageIndex;
             Entity->Updatable = false;
+            Entity->SweepIndex = SIM_SWEEP_NO_ENTRY;
         }
         else
         {
@@ -148,18 +377,126 @@ AddEntity(game_state *GameState, sim_region *SimRegion, uint32 StorageIndex, low
         {
             Dest->P = GetSimSpaceP(SimRegion, Source);
         }
+
+        AppendToSimSweep(SimRegion, Dest);
     }
 
     return(Dest);
 }
 
+internal uint32
+GatherSimChunks(sim_region *SimRegion, game_state *GameState, bool32 GatherEntities)
+{
+    // NOTE(casey): Chunks that were paged out get their entities gathered
+    // even if GatherEntities is false, since a region that's being kept
+    // can't have seen them yet.  Returns how many entities were added.
+    uint32 AddedCount = 0;
+    world *World = SimRegion->World;
+    world_position MinChunkP = MapIntoChunkSpace(World, SimRegion->Origin, GetMinCorner(SimRegion->Bounds));
+    world_position MaxChunkP = MapIntoChunkSpace(World, SimRegion->Origin, GetMaxCorner(SimRegion->Bounds));
+    
+    // NOTE(casey): Chunks are walked a brick at a time, and in Morton order
+    // inside each brick, so the gather reads chunks in the order they sit
+    // in memory and only does one hash lookup per brick.
+    int32 MinBrickX = GetBrickCoord(MinChunkP.ChunkX);
+    int32 MinBrickY = GetBrickCoord(MinChunkP.ChunkY);
+    int32 MaxBrickX = GetBrickCoord(MaxChunkP.ChunkX);
+    int32 MaxBrickY = GetBrickCoord(MaxChunkP.ChunkY);
+    for(int32 ChunkZ = MinChunkP.ChunkZ;
+        ChunkZ <= MaxChunkP.ChunkZ;
+        ++ChunkZ)
+    {
+        for(int32 BrickY = MinBrickY;
+            BrickY <= MaxBrickY;
+            ++BrickY)
+        {
+            for(int32 BrickX = MinBrickX;
+                BrickX <= MaxBrickX;
+                ++BrickX)
+            {
+                world_chunk_brick *Brick = GetChunkBrick(World, BrickX, BrickY, ChunkZ);
+                if(Brick)
+                {
+                    uint32 ChunkMask = Brick->ChunkMask &
+                        GetBrickChunkMask(BrickX, BrickY,
+                                          MinChunkP.ChunkX, MinChunkP.ChunkY,
+                                          MaxChunkP.ChunkX, MaxChunkP.ChunkY);
+                    while(ChunkMask)
+                    {
+                        bit_scan_result ChunkScan = FindLeastSignificantSetBit(ChunkMask);
+                        Assert(ChunkScan.Found);
+                        ChunkMask &= ~(1 << ChunkScan.Index);
+
+                        world_chunk *Chunk = Brick->Chunks + ChunkScan.Index;
+                        bool32 WasPaged = Chunk->Paged;
+                        if(!UseWorldChunk(&GameState->WorldArena, World, GameState->LowEntities, Chunk))
+                        {
+                            // NOTE(casey): Couldn't page it back in, so it's
+                            // left out of the sim region this time around
+                            continue;
+                        }
+                        
+                        if(!GatherEntities && !WasPaged)
+                        {
+                            continue;
+                        }
+
+                        // NOTE(casey): This is Subtract() split in two, the
+                        // chunk half here and the offset half per entity, so
+                        // it comes out exactly the same as GetSimSpaceP
+                        v3 dChunk = {(real32)Chunk->ChunkX - (real32)SimRegion->Origin.ChunkX,
+                                     (real32)Chunk->ChunkY - (real32)SimRegion->Origin.ChunkY,
+                                     (real32)Chunk->ChunkZ - (real32)SimRegion->Origin.ChunkZ};
+                        v3 ChunkDelta = Hadamard(World->ChunkDimInMeters, dChunk);
+                        for(world_entity_block *Block = &Chunk->FirstBlock;
+                            Block;
+                            Block = Block->Next)
+                        {
+                            for(uint32 EntityIndexIndex = 0;
+                                EntityIndexIndex < Block->EntityCount;
+                                ++EntityIndexIndex)
+                            {
+                                // NOTE(casey): Entities in chunks are always
+                                // spatial, so there's no flag to check here
+                                v3 SimSpaceP = ChunkDelta + (Block->EntityOffset[EntityIndexIndex] -
+                                                             SimRegion->Origin.Offset_);
+                                rectangle3 Grown = AddRadiusTo(SimRegion->Bounds, Block->EntityRadius[EntityIndexIndex]);
+                                if(IsInRectangle(Grown, SimSpaceP))
+                                {
+                                    uint32 LowEntityIndex = Block->LowEntityIndex[EntityIndexIndex];
+                                    low_entity *Low = GameState->LowEntities[LowEntityIndex];
+                                    Assert(!IsSet(&Low->Sim, EntityFlag_Nonspatial));
+                                    AddEntity(GameState, SimRegion, LowEntityIndex, Low, &SimSpaceP);
+                                    ++AddedCount;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return(AddedCount);
+}
+
+internal void
+RebuildSimSweep(sim_region *SimRegion, memory_arena *TempArena)
+{
+    temporary_memory SortMemory = BeginTemporaryMemory(TempArena);
+    SortSimSweep(SimRegion, PushArray(TempArena, SimRegion->SweepCount, sim_sweep_entry));
+    EndTemporaryMemory(SortMemory);
+}
+
 internal sim_region *
-BeginSim(memory_arena *SimArena, game_state *GameState, world *World, world_position Origin, rectangle3 Bounds, real32 dt)
+BeginSim(memory_arena *SimArena, sim_entity_hash_table *Hash, game_state *GameState, world *World,
+         world_position Origin, rectangle3 Bounds, real32 dt)
 {
     // TODO(casey): If entities were stored in the world, we wouldn't need the game state here!
     
     sim_region *SimRegion = PushStruct(SimArena, sim_region);
-    ZeroStruct(SimRegion->Hash);
+    SimRegion->Hash = Hash;
+    ClearSimEntityHash(SimRegion->Hash);
 
     // TODO(casey): Try to make these get enforced more rigorously
     // TODO(casey): Perhaps try using a dual system here, where we support
@@ -172,6 +509,7 @@ BeginSim(memory_arena *SimArena, game_state *GameState, world *World, world_posi
     
     SimRegion->World = World;
     SimRegion->Origin = Origin;
+    SimRegion->CameraOffset = V3(0, 0, 0);
     SimRegion->UpdatableBounds = AddRadiusTo(Bounds, V3(SimRegion->MaxEntityRadius,
                                                         SimRegion->MaxEntityRadius,
                                                         SimRegion->MaxEntityRadius));
@@ -182,123 +520,337 @@ BeginSim(memory_arena *SimArena, game_state *GameState, world *World, world_posi
     SimRegion->MaxEntityCount = 4096;
     SimRegion->EntityCount = 0;
     SimRegion->Entities = PushArray(SimArena, SimRegion->MaxEntityCount, sim_entity);
-    
-    world_position MinChunkP = MapIntoChunkSpace(World, SimRegion->Origin, GetMinCorner(SimRegion->Bounds));
-    world_position MaxChunkP = MapIntoChunkSpace(World, SimRegion->Origin, GetMaxCorner(SimRegion->Bounds));
-    
-	for (int32 ChunkZ = MinChunkP.ChunkZ;
-		ChunkZ <= MaxChunkP.ChunkZ;
-		++ChunkZ)
-	{
-		for (int32 ChunkY = MinChunkP.ChunkY;
-			ChunkY <= MaxChunkP.ChunkY;
-			++ChunkY)
-		{
-			for (int32 ChunkX = MinChunkP.ChunkX;
-				ChunkX <= MaxChunkP.ChunkX;
-				++ChunkX)
-			{
-				world_chunk *Chunk = GetWorldChunk(World, ChunkX, ChunkY, ChunkZ);
-				if (Chunk)
-				{
-					for (world_entity_block *Block = &Chunk->FirstBlock;
-						Block;
-						Block = Block->Next)
-					{
-						for (uint32 EntityIndexIndex = 0;
-							EntityIndexIndex < Block->EntityCount;
-							++EntityIndexIndex)
-						{
-							uint32 LowEntityIndex = Block->LowEntityIndex[EntityIndexIndex];
-							low_entity *Low = GameState->LowEntities + LowEntityIndex;
-							if (!IsSet(&Low->Sim, EntityFlag_Nonspatial))
-							{
-								v3 SimSpaceP = GetSimSpaceP(SimRegion, Low);
-								if (EntityOverlapsRectangle(SimSpaceP, Low->Sim.Dim, SimRegion->Bounds))
-								{
-									AddEntity(GameState, SimRegion, LowEntityIndex, Low, &SimSpaceP);
-								}
-							}
-						}
-					}
-				}
-			}
-		}
-	}
+
+    SimRegion->SweepCount = 0;
+    SimRegion->SweepMaxDimX = 0.0f;
+    SimRegion->SweepEntries = PushArray(SimArena, SimRegion->MaxEntityCount, sim_sweep_entry);
+    uint32 CandidateWordCount = (SimRegion->MaxEntityCount + 31) / 32;
+    SimRegion->CandidateBits = PushArray(SimArena, CandidateWordCount, uint32);
+    ZeroSize(CandidateWordCount*sizeof(uint32), SimRegion->CandidateBits);
+    SimRegion->Candidates = PushArray(SimArena, SimRegion->MaxEntityCount, sim_entity *);
+
+    GatherSimChunks(SimRegion, GameState, true);
+    SimRegion->GatheredLowEntityCount = GameState->LowEntityCount;
+    RebuildSimSweep(SimRegion, SimArena);
 
     return(SimRegion);
 }
 
 internal void
-EndSim(sim_region *Region, game_state *GameState)
+StoreSimEntity(sim_region *Region, game_state *GameState, sim_entity *Entity,
+               entity_relocation *Removals, uint32 *RemovalCount,
+               entity_relocation *Insertions, uint32 *InsertionCount)
+{
+    world *World = GameState->World;
+    low_entity *Stored = GameState->LowEntities[Entity->StorageIndex];
+    world_position OldP = Stored->P;
+
+    Assert(IsSet(&Stored->Sim, EntityFlag_Simming));
+    Stored->Sim = *Entity;
+    Assert(!IsSet(&Stored->Sim, EntityFlag_Simming));
+
+    StoreEntityReference(&Stored->Sim.Sword);
+
+    // TODO(casey): Save state back to the stored entity, once high entities
+    // do state decompression, etc.
+        
+    world_position NewP = IsSet(Entity, EntityFlag_Nonspatial) ?
+        NullPosition() :
+        MapIntoChunkSpace(World, Region->Origin, Entity->P);
+    bool32 WasSpatial = IsValid(OldP);
+    bool32 IsSpatial = IsValid(NewP);
+    SetEntityP(Stored, IsSpatial ? &NewP : 0);
+    if(WasSpatial && IsSpatial && AreInSameChunk(World, &OldP, &NewP))
+    {
+        // NOTE(casey): Leave entity where it is
+        RefreshChunkBlockEntry(Stored);
+    }
+    else
+    {
+        if(WasSpatial)
+        {
+            entity_relocation *Removal = Removals + (*RemovalCount)++;
+            Removal->ChunkX = OldP.ChunkX;
+            Removal->ChunkY = OldP.ChunkY;
+            Removal->ChunkZ = OldP.ChunkZ;
+            Removal->LowEntityIndex = Entity->StorageIndex;
+        }
+
+        if(IsSpatial)
+        {
+            entity_relocation *Insertion = Insertions + (*InsertionCount)++;
+            Insertion->ChunkX = NewP.ChunkX;
+            Insertion->ChunkY = NewP.ChunkY;
+            Insertion->ChunkZ = NewP.ChunkZ;
+            Insertion->LowEntityIndex = Entity->StorageIndex;
+        }
+    }
+}
+
+internal void
+FollowWithCamera(game_state *GameState, world_position EntityP)
+{
+    world_position NewCameraP = GameState->CameraP;
+        
+    NewCameraP.ChunkZ = EntityP.ChunkZ;
+
+#if 0
+    if(CameraFollowingEntity.High->P.X > (9.0f*World->TileSideInMeters))
+    {
+        NewCameraP.AbsTileX += 17;
+    }
+    if(CameraFollowingEntity.High->P.X < -(9.0f*World->TileSideInMeters))
+    {
+        NewCameraP.AbsTileX -= 17;
+    }
+    if(CameraFollowingEntity.High->P.Y > (5.0f*World->TileSideInMeters))
+    {
+        NewCameraP.AbsTileY += 9;
+    }
+    if(CameraFollowingEntity.High->P.Y < -(5.0f*World->TileSideInMeters))
+    {
+        NewCameraP.AbsTileY -= 9;
+    }
+#else
+    real32 CamZOffset = NewCameraP.Offset_.Z;
+    NewCameraP = EntityP;
+    NewCameraP.Offset_.Z = CamZOffset;
+#endif
+
+    GameState->CameraP = NewCameraP;
+}
+
+internal void
+EndSim(sim_region *Region, game_state *GameState, memory_arena *TempArena)
 {
     // TODO(casey): Maybe don't take a game state here, low entities should be stored
     // in the world??
+
+    world *World = GameState->World;
+    temporary_memory RelocationMemory = BeginTemporaryMemory(TempArena);
+    
+    // NOTE(casey): Chunk moves are queued up here and applied all at once
+    // below, so each chunk touched is only looked up once.
+    uint32 RemovalCount = 0;
+    uint32 InsertionCount = 0;
+    entity_relocation *Removals = PushArray(TempArena, Region->EntityCount, entity_relocation);
+    entity_relocation *Insertions = PushArray(TempArena, Region->EntityCount, entity_relocation);
+    entity_relocation *RelocationTemp = PushArray(TempArena, Region->EntityCount, entity_relocation);
     
     sim_entity *Entity = Region->Entities;
     for(uint32 EntityIndex = 0;
         EntityIndex < Region->EntityCount;
         ++EntityIndex, ++Entity)
     {
-        low_entity *Stored = GameState->LowEntities + Entity->StorageIndex;
+        StoreSimEntity(Region, GameState, Entity, Removals, &RemovalCount, Insertions, &InsertionCount);
+
+        if(Entity->StorageIndex == GameState->CameraFollowingEntityIndex)
+        {
+            FollowWithCamera(GameState, GameState->LowEntities[Entity->StorageIndex]->P);
+        }
+    }
 
-        Assert(IsSet(&Stored->Sim, EntityFlag_Simming));
-        Stored->Sim = *Entity;
-        Assert(!IsSet(&Stored->Sim, EntityFlag_Simming));
+    ApplyEntityRelocations(&GameState->WorldArena, World, GameState->LowEntities,
+                           RemovalCount, Removals, InsertionCount, Insertions,
+                           RelocationTemp);
+    
+    EndTemporaryMemory(RelocationMemory);
+}
 
-        StoreEntityReference(&Stored->Sim.Sword);
+//
+// NOTE(casey): Persistent sim regions
+//
 
-        // TODO(casey): Save state back to the stored entity, once high entities
-        // do state decompression, etc.
-        
-        world_position NewP = IsSet(Entity, EntityFlag_Nonspatial) ?
-            NullPosition() :
-            MapIntoChunkSpace(GameState->World, Region->Origin, Entity->P);
-        ChangeEntityLocation(&GameState->WorldArena, GameState->World, Entity->StorageIndex,
-                             Stored, NewP);
+internal bool32
+SimRegionCanFollowCamera(sim_region *SimRegion, world_position CameraP, v3 CameraSlack)
+{
+    v3 CameraOffset = Subtract(SimRegion->World, &CameraP, &SimRegion->Origin);
+    bool32 Result = ((CameraP.ChunkZ == SimRegion->Origin.ChunkZ) &&
+                     (AbsoluteValue(CameraOffset.X) <= CameraSlack.X) &&
+                     (AbsoluteValue(CameraOffset.Y) <= CameraSlack.Y));
 
-        if(Entity->StorageIndex == GameState->CameraFollowingEntityIndex)
-        {
-            world_position NewCameraP = GameState->CameraP;
-        
-            NewCameraP.ChunkZ = Stored->P.ChunkZ;
+    return(Result);
+}
 
-#if 0
-            if(CameraFollowingEntity.High->P.X > (9.0f*World->TileSideInMeters))
+internal void
+RefreshSim(sim_region *SimRegion, game_state *GameState, memory_arena *TempArena)
+{
+    // NOTE(casey): Nothing outside the region moves, so the only things
+    // that can show up inside it are entities made since the last gather,
+    // and the ones in chunks that couldn't be paged in until now.  Every
+    // chunk under it still has to be marked as used, too, or the stored
+    // copies of what's in the region could get paged out.
+    uint32 AddedCount = GatherSimChunks(SimRegion, GameState, false);
+
+    for(uint32 LowEntityIndex = SimRegion->GatheredLowEntityCount;
+        LowEntityIndex < GameState->LowEntityCount;
+        ++LowEntityIndex)
+    {
+        low_entity *Low = GetLowEntity(GameState, LowEntityIndex);
+        if(Low &&
+           !IsSet(&Low->Sim, EntityFlag_Nonspatial) &&
+           !IsSet(&Low->Sim, EntityFlag_Simming))
+        {
+            v3 SimSpaceP = GetSimSpaceP(SimRegion, Low);
+            if(EntityOverlapsRectangle(SimSpaceP, Low->Sim.Dim, SimRegion->Bounds))
             {
-                NewCameraP.AbsTileX += 17;
+                AddEntity(GameState, SimRegion, LowEntityIndex, Low, &SimSpaceP);
+                ++AddedCount;
             }
-            if(CameraFollowingEntity.High->P.X < -(9.0f*World->TileSideInMeters))
+        }
+    }
+    SimRegion->GatheredLowEntityCount = GameState->LowEntityCount;
+
+    if(AddedCount)
+    {
+        RebuildSimSweep(SimRegion, TempArena);
+    }
+}
+
+internal void
+SetSimRegionCamera(sim_region *SimRegion, world_position CameraP, rectangle3 CameraBounds)
+{
+    // NOTE(casey): Same updatable bounds BeginSim would have made for a
+    // region centered on the camera, just moved to wherever the camera has
+    // got to inside this one.
+    SimRegion->CameraOffset = Subtract(SimRegion->World, &CameraP, &SimRegion->Origin);
+    rectangle3 UpdatableBounds = AddRadiusTo(CameraBounds, V3(SimRegion->MaxEntityRadius,
+                                                              SimRegion->MaxEntityRadius,
+                                                              SimRegion->MaxEntityRadius));
+    SimRegion->UpdatableBounds = RectMinMax(UpdatableBounds.Min + SimRegion->CameraOffset,
+                                            UpdatableBounds.Max + SimRegion->CameraOffset);
+    
+    sim_entity *Entity = SimRegion->Entities;
+    for(uint32 EntityIndex = 0;
+        EntityIndex < SimRegion->EntityCount;
+        ++EntityIndex, ++Entity)
+    {
+        Entity->Updatable = EntityOverlapsRectangle(Entity->P, Entity->Dim, SimRegion->UpdatableBounds);
+    }
+}
+
+internal void
+PruneSim(sim_region *Region, game_state *GameState, memory_arena *TempArena)
+{
+    // NOTE(casey): The end of frame for a persistent region.  Only entities
+    // that have left it get written back to the world.
+    world *World = GameState->World;
+    temporary_memory PruneMemory = BeginTemporaryMemory(TempArena);
+
+    // NOTE(casey): Spatial entities stay as long as they still touch the
+    // bounds, and anything referenced by an entity that stays, stays too.
+    bool32 *Keep = PushArray(TempArena, Region->EntityCount, bool32);
+    uint32 LeavingCount = 0;
+    for(uint32 EntityIndex = 0;
+        EntityIndex < Region->EntityCount;
+        ++EntityIndex)
+    {
+        sim_entity *Entity = Region->Entities + EntityIndex;
+        Keep[EntityIndex] = (!IsSet(Entity, EntityFlag_Nonspatial) &&
+                             EntityOverlapsRectangle(Entity->P, Entity->Dim, Region->Bounds));
+
+        if(Entity->StorageIndex == GameState->CameraFollowingEntityIndex)
+        {
+            FollowWithCamera(GameState, MapIntoChunkSpace(World, Region->Origin, Entity->P));
+        }
+    }
+    for(uint32 EntityIndex = 0;
+        EntityIndex < Region->EntityCount;
+        ++EntityIndex)
+    {
+        sim_entity *Entity = Region->Entities + EntityIndex;
+        if(Keep[EntityIndex] && Entity->Sword.Ptr)
+        {
+            Keep[Entity->Sword.Ptr - Region->Entities] = true;
+        }
+    }
+    for(uint32 EntityIndex = 0;
+        EntityIndex < Region->EntityCount;
+        ++EntityIndex)
+    {
+        if(!Keep[EntityIndex])
+        {
+            ++LeavingCount;
+        }
+    }
+
+    if(LeavingCount)
+    {
+        uint32 RemovalCount = 0;
+        uint32 InsertionCount = 0;
+        entity_relocation *Removals = PushArray(TempArena, LeavingCount, entity_relocation);
+        entity_relocation *Insertions = PushArray(TempArena, LeavingCount, entity_relocation);
+        entity_relocation *RelocationTemp = PushArray(TempArena, LeavingCount, entity_relocation);
+
+        // NOTE(casey): Everything leaving is stored before anything is
+        // moved, since storing reads through sword pointers.
+        for(uint32 EntityIndex = 0;
+            EntityIndex < Region->EntityCount;
+            ++EntityIndex)
+        {
+            if(!Keep[EntityIndex])
             {
-                NewCameraP.AbsTileX -= 17;
+                StoreSimEntity(Region, GameState, Region->Entities + EntityIndex,
+                               Removals, &RemovalCount, Insertions, &InsertionCount);
             }
-            if(CameraFollowingEntity.High->P.Y > (5.0f*World->TileSideInMeters))
+        }
+
+        sim_entity **Remap = PushArray(TempArena, Region->EntityCount, sim_entity *);
+        uint32 KeptCount = 0;
+        for(uint32 EntityIndex = 0;
+            EntityIndex < Region->EntityCount;
+            ++EntityIndex)
+        {
+            Remap[EntityIndex] = 0;
+            if(Keep[EntityIndex])
             {
-                NewCameraP.AbsTileY += 9;
+                Remap[EntityIndex] = Region->Entities + KeptCount;
+                Region->Entities[KeptCount++] = Region->Entities[EntityIndex];
             }
-            if(CameraFollowingEntity.High->P.Y < -(5.0f*World->TileSideInMeters))
+        }
+        Region->EntityCount = KeptCount;
+
+        // NOTE(casey): Everything that points at entities gets rebuilt
+        // against where they are now.
+        ClearSimEntityHash(Region->Hash);
+        Region->SweepCount = 0;
+        sim_entity *Entity = Region->Entities;
+        for(uint32 EntityIndex = 0;
+            EntityIndex < Region->EntityCount;
+            ++EntityIndex, ++Entity)
+        {
+            if(Entity->Sword.Ptr)
             {
-                NewCameraP.AbsTileY -= 9;
+                Entity->Sword.Ptr = Remap[Entity->Sword.Ptr - Region->Entities];
+                Assert(Entity->Sword.Ptr);
             }
-#else
-            real32 CamZOffset = NewCameraP.Offset_.Z;
-            NewCameraP = Stored->P;
-            NewCameraP.Offset_.Z = CamZOffset;
-#endif
 
-            GameState->CameraP = NewCameraP;
+            sim_entity_hash *Entry = GetHashFromStorageIndex(Region, Entity->StorageIndex);
+            Entry->Index = Entity->StorageIndex;
+            Entry->Ptr = Entity;
+
+            Entity->SweepIndex = SIM_SWEEP_NO_ENTRY;
+            AppendToSimSweep(Region, Entity);
         }
+        RebuildSimSweep(Region, TempArena);
 
+        ApplyEntityRelocations(&GameState->WorldArena, World, GameState->LowEntities,
+                               RemovalCount, Removals, InsertionCount, Insertions,
+                               RelocationTemp);
     }
+
+    EndTemporaryMemory(PruneMemory);
 }
 
+#define TEST_WALL_T_EPSILON 0.001f
+
 internal bool32
 TestWall(real32 WallX, real32 RelX, real32 RelY, real32 PlayerDeltaX, real32 PlayerDeltaY,
          real32 *tMin, real32 MinY, real32 MaxY)
 {
     bool32 Hit = false;
     
-    real32 tEpsilon = 0.001f;
+    real32 tEpsilon = TEST_WALL_T_EPSILON;
     if(PlayerDeltaX != 0.0f)
     {
         real32 tResult = (WallX - RelX) / PlayerDeltaX;
@@ -316,6 +868,161 @@ TestWall(real32 WallX, real32 RelX, real32 RelY, real32 PlayerDeltaX, real32 Pla
     return(Hit);
 }
 
+internal void
+TestWalls(sim_entity *Entity, v3 PlayerDelta, uint32 TestCount, sim_entity **TestEntities,
+          real32 *tMin, v3 *WallNormal, sim_entity **HitEntity)
+{
+    for(uint32 TestIndex = 0;
+        TestIndex < TestCount;
+        ++TestIndex)
+    {
+        sim_entity *TestEntity = TestEntities[TestIndex];
+        v3 MinkowskiDiameter = {TestEntity->Dim.X + Entity->Dim.X,
+                                TestEntity->Dim.Y + Entity->Dim.Y,
+                                TestEntity->Dim.Z + Entity->Dim.Z};
+
+        v3 MinCorner = -0.5f*MinkowskiDiameter;
+        v3 MaxCorner = 0.5f*MinkowskiDiameter;
+
+        v3 Rel = Entity->P - TestEntity->P;
+
+        if(TestWall(MinCorner.X, Rel.X, Rel.Y, PlayerDelta.X, PlayerDelta.Y,
+                    tMin, MinCorner.Y, MaxCorner.Y))
+        {
+            *WallNormal = V3(-1, 0, 0);
+            *HitEntity = TestEntity;
+        }
+                
+        if(TestWall(MaxCorner.X, Rel.X, Rel.Y, PlayerDelta.X, PlayerDelta.Y,
+                    tMin, MinCorner.Y, MaxCorner.Y))
+        {
+            *WallNormal = V3(1, 0, 0);
+            *HitEntity = TestEntity;
+        }
+                
+        if(TestWall(MinCorner.Y, Rel.Y, Rel.X, PlayerDelta.Y, PlayerDelta.X,
+                    tMin, MinCorner.X, MaxCorner.X))
+        {
+            *WallNormal = V3(0, -1, 0);
+            *HitEntity = TestEntity;
+        }
+                
+        if(TestWall(MaxCorner.Y, Rel.Y, Rel.X, PlayerDelta.Y, PlayerDelta.X,
+                    tMin, MinCorner.X, MaxCorner.X))
+        {
+            *WallNormal = V3(0, 1, 0);
+            *HitEntity = TestEntity;
+        }
+    }
+}
+
+inline __m128
+TestWallLanes(__m128 WallX, __m128 RelX, __m128 RelY, real32 PlayerDeltaX, real32 PlayerDeltaY,
+              __m128 MinY, __m128 MaxY, __m128 *tResult)
+{
+    // NOTE(casey): Same arithmetic as TestWall, in the same order, so tResult
+    // comes out bit for bit the same.  Only the part that doesn't depend on
+    // tMin is done here; the caller folds tMin in lane by lane.
+    __m128 Valid = _mm_setzero_ps();
+    *tResult = _mm_setzero_ps();
+    if(PlayerDeltaX != 0.0f)
+    {
+        *tResult = _mm_div_ps(_mm_sub_ps(WallX, RelX), _mm_set1_ps(PlayerDeltaX));
+        __m128 Y = _mm_add_ps(RelY, _mm_mul_ps(*tResult, _mm_set1_ps(PlayerDeltaY)));
+        Valid = _mm_and_ps(_mm_cmpge_ps(*tResult, _mm_setzero_ps()),
+                           _mm_and_ps(_mm_cmpge_ps(Y, MinY), _mm_cmple_ps(Y, MaxY)));
+    }
+
+    return(Valid);
+}
+
+internal void
+TestWalls4x(sim_entity *Entity, v3 PlayerDelta, uint32 TestCount, sim_entity **TestEntities,
+            real32 *tMin, v3 *WallNormal, sim_entity **HitEntity)
+{
+    v3 Normals[4] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}};
+    __m128 EntityPX = _mm_set1_ps(Entity->P.X);
+    __m128 EntityPY = _mm_set1_ps(Entity->P.Y);
+    __m128 EntityDimX = _mm_set1_ps(Entity->Dim.X);
+    __m128 EntityDimY = _mm_set1_ps(Entity->Dim.Y);
+    __m128 Half = _mm_set1_ps(0.5f);
+    __m128 NegativeHalf = _mm_set1_ps(-0.5f);
+
+    for(uint32 FirstIndex = 0;
+        FirstIndex < TestCount;
+        FirstIndex += 4)
+    {
+        // NOTE(casey): Lanes past the end repeat the last entity and get
+        // masked off below.
+        sim_entity *Lanes[4];
+        uint32 LaneCount = Minimum(TestCount - FirstIndex, 4);
+        for(uint32 LaneIndex = 0;
+            LaneIndex < 4;
+            ++LaneIndex)
+        {
+            Lanes[LaneIndex] = TestEntities[FirstIndex + Minimum(LaneIndex, LaneCount - 1)];
+        }
+
+        __m128 TestPX = _mm_setr_ps(Lanes[0]->P.X, Lanes[1]->P.X, Lanes[2]->P.X, Lanes[3]->P.X);
+        __m128 TestPY = _mm_setr_ps(Lanes[0]->P.Y, Lanes[1]->P.Y, Lanes[2]->P.Y, Lanes[3]->P.Y);
+        __m128 TestDimX = _mm_setr_ps(Lanes[0]->Dim.X, Lanes[1]->Dim.X, Lanes[2]->Dim.X, Lanes[3]->Dim.X);
+        __m128 TestDimY = _mm_setr_ps(Lanes[0]->Dim.Y, Lanes[1]->Dim.Y, Lanes[2]->Dim.Y, Lanes[3]->Dim.Y);
+
+        __m128 DiameterX = _mm_add_ps(TestDimX, EntityDimX);
+        __m128 DiameterY = _mm_add_ps(TestDimY, EntityDimY);
+        __m128 MinCornerX = _mm_mul_ps(NegativeHalf, DiameterX);
+        __m128 MinCornerY = _mm_mul_ps(NegativeHalf, DiameterY);
+        __m128 MaxCornerX = _mm_mul_ps(Half, DiameterX);
+        __m128 MaxCornerY = _mm_mul_ps(Half, DiameterY);
+        __m128 RelX = _mm_sub_ps(EntityPX, TestPX);
+        __m128 RelY = _mm_sub_ps(EntityPY, TestPY);
+
+        __m128 tResult[4];
+        int ValidMask[4];
+        ValidMask[0] = _mm_movemask_ps(TestWallLanes(MinCornerX, RelX, RelY, PlayerDelta.X, PlayerDelta.Y,
+                                                     MinCornerY, MaxCornerY, &tResult[0]));
+        ValidMask[1] = _mm_movemask_ps(TestWallLanes(MaxCornerX, RelX, RelY, PlayerDelta.X, PlayerDelta.Y,
+                                                     MinCornerY, MaxCornerY, &tResult[1]));
+        ValidMask[2] = _mm_movemask_ps(TestWallLanes(MinCornerY, RelY, RelX, PlayerDelta.Y, PlayerDelta.X,
+                                                     MinCornerX, MaxCornerX, &tResult[2]));
+        ValidMask[3] = _mm_movemask_ps(TestWallLanes(MaxCornerY, RelY, RelX, PlayerDelta.Y, PlayerDelta.X,
+                                                     MinCornerX, MaxCornerX, &tResult[3]));
+
+        int LaneMask = (1 << LaneCount) - 1;
+        if((ValidMask[0] | ValidMask[1] | ValidMask[2] | ValidMask[3]) & LaneMask)
+        {
+            // NOTE(casey): tMin has to be folded in entity by entity, wall
+            // by wall, because each hit backs tMin off by the epsilon and
+            // that changes which of the later hits count.
+            real32 t[4][4];
+            for(uint32 WallIndex = 0;
+                WallIndex < 4;
+                ++WallIndex)
+            {
+                _mm_storeu_ps(t[WallIndex], tResult[WallIndex]);
+            }
+
+            for(uint32 LaneIndex = 0;
+                LaneIndex < LaneCount;
+                ++LaneIndex)
+            {
+                for(uint32 WallIndex = 0;
+                    WallIndex < 4;
+                    ++WallIndex)
+                {
+                    if((ValidMask[WallIndex] & (1 << LaneIndex)) &&
+                       (*tMin > t[WallIndex][LaneIndex]))
+                    {
+                        *tMin = Maximum(0.0f, t[WallIndex][LaneIndex] - TEST_WALL_T_EPSILON);
+                        *WallNormal = Normals[WallIndex];
+                        *HitEntity = Lanes[LaneIndex];
+                    }
+                }
+            }
+        }
+    }
+}
+
 internal bool32
 CanCollide(game_state *GameState, sim_entity *A, sim_entity *B)
 {
@@ -497,52 +1204,42 @@ MoveEntity(game_state *GameState, sim_region *SimRegion, sim_entity *Entity, rea
             // loop in the case where the test entity is non-spatial!
             if(!IsSet(Entity, EntityFlag_Nonspatial))
             {
-                // TODO(casey): Spatial partition here!
-                for(uint32 TestHighEntityIndex = 0;
-                    TestHighEntityIndex < SimRegion->EntityCount;
-                    ++TestHighEntityIndex)
+                // NOTE(casey): Anything that can stop us overlaps the box
+                // we sweep through (plus a hair for the rounding in TestWall).
+                real32 QueryRadius = 0.01f;
+                v2 SweepMin = {Minimum(Entity->P.X, DesiredPosition.X), Minimum(Entity->P.Y, DesiredPosition.Y)};
+                v2 SweepMax = {Maximum(Entity->P.X, DesiredPosition.X), Maximum(Entity->P.Y, DesiredPosition.Y)};
+                rectangle2 Query = AddRadiusTo(RectMinMax(SweepMin, SweepMax),
+                                               0.5f*Entity->Dim.XY + V2(QueryRadius, QueryRadius));
+                uint32 CandidateCount = GatherSimSweepCandidates(SimRegion, Query);
+                uint32 TestCount = 0;
+                for(uint32 CandidateIndex = 0;
+                    CandidateIndex < CandidateCount;
+                    ++CandidateIndex)
                 {
-                    sim_entity *TestEntity = SimRegion->Entities + TestHighEntityIndex;
+                    sim_entity *TestEntity = SimRegion->Candidates[CandidateIndex];
                     if(CanCollide(GameState, Entity, TestEntity))
                     {
-                        v3 MinkowskiDiameter = {TestEntity->Dim.X + Entity->Dim.X,
-                                                TestEntity->Dim.Y + Entity->Dim.Y,
-                                                TestEntity->Dim.Z + Entity->Dim.Z};
-
-                        v3 MinCorner = -0.5f*MinkowskiDiameter;
-                        v3 MaxCorner = 0.5f*MinkowskiDiameter;
-
-                        v3 Rel = Entity->P - TestEntity->P;
-
-                        if(TestWall(MinCorner.X, Rel.X, Rel.Y, PlayerDelta.X, PlayerDelta.Y,
-                                    &tMin, MinCorner.Y, MaxCorner.Y))
-                        {
-                            WallNormal = V3(-1, 0, 0);
-                            HitEntity = TestEntity;
-                        }
-                
-                        if(TestWall(MaxCorner.X, Rel.X, Rel.Y, PlayerDelta.X, PlayerDelta.Y,
-                                    &tMin, MinCorner.Y, MaxCorner.Y))
-                        {
-                            WallNormal = V3(1, 0, 0);
-                            HitEntity = TestEntity;
-                        }
-                
-                        if(TestWall(MinCorner.Y, Rel.Y, Rel.X, PlayerDelta.Y, PlayerDelta.X,
-                                    &tMin, MinCorner.X, MaxCorner.X))
-                        {
-                            WallNormal = V3(0, -1, 0);
-                            HitEntity = TestEntity;
-                        }
-                
-                        if(TestWall(MaxCorner.Y, Rel.Y, Rel.X, PlayerDelta.Y, PlayerDelta.X,
-                                    &tMin, MinCorner.X, MaxCorner.X))
-                        {
-                            WallNormal = V3(0, 1, 0);
-                            HitEntity = TestEntity;
-                        }
+                        SimRegion->Candidates[TestCount++] = TestEntity;
                     }
                 }
+
+#if HANDMADE_SLOW
+                real32 ScalarMin = tMin;
+                v3 ScalarNormal = WallNormal;
+                sim_entity *ScalarHit = HitEntity;
+                TestWalls(Entity, PlayerDelta, TestCount, SimRegion->Candidates,
+                          &ScalarMin, &ScalarNormal, &ScalarHit);
+#endif
+                TestWalls4x(Entity, PlayerDelta, TestCount, SimRegion->Candidates,
+                            &tMin, &WallNormal, &HitEntity);
+#if HANDMADE_SLOW
+                // NOTE(casey): Which wall got hit has to agree exactly, but
+                // with -fp:fast the two are free to round t differently
+                Assert(AbsoluteValue(ScalarMin - tMin) <= TEST_WALL_T_EPSILON);
+                Assert((ScalarNormal.X == WallNormal.X) && (ScalarNormal.Y == WallNormal.Y));
+                Assert(ScalarHit == HitEntity);
+#endif
             }
                
             Entity->P += tMin*PlayerDelta;
@@ -576,12 +1273,15 @@ MoveEntity(game_state *GameState, sim_region *SimRegion, sim_entity *Entity, rea
 	{
 		rectangle3 EntityRect = RectCenterDim(Entity->P, Entity->Dim);
 
-		// TODO(casey): Spatial partition here!
-		for (uint32 TestHighEntityIndex = 0;
-			TestHighEntityIndex < SimRegion->EntityCount;
-			++TestHighEntityIndex)
+		real32 QueryRadius = 0.01f;
+		rectangle2 Query = AddRadiusTo(RectMinMax(EntityRect.Min.XY, EntityRect.Max.XY),
+									   V2(QueryRadius, QueryRadius));
+		uint32 CandidateCount = GatherSimSweepCandidates(SimRegion, Query);
+		for (uint32 CandidateIndex = 0;
+			CandidateIndex < CandidateCount;
+			++CandidateIndex)
 		{
-			sim_entity *TestEntity = SimRegion->Entities + TestHighEntityIndex;
+			sim_entity *TestEntity = SimRegion->Candidates[CandidateIndex];
 			if (CanOverlap(GameState, Entity, TestEntity))
 			{
 				rectangle3 TestEntityRect = RectCenterDim(TestEntity->P, TestEntity->Dim);
@@ -601,6 +1301,8 @@ MoveEntity(game_state *GameState, sim_region *SimRegion, sim_entity *Entity, rea
         Entity->dP.Z = 0;
     }
 
+    UpdateSimSweep(SimRegion, Entity);
+
     if(Entity->DistanceLimit != 0.0f)
     {
         Entity->DistanceLimit = DistanceRemaining;
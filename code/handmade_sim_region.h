@@ -58,6 +58,7 @@ struct sim_entity
     world_chunk *OldChunk;
     uint32 StorageIndex;
     bool32 Updatable;
+    uint32 SweepIndex;
 
     //
     
@@ -82,6 +83,10 @@ struct sim_entity
 
     entity_reference Sword;
 
+    // NOTE(casey): What this entity drew last frame, for incremental redraw
+    rectangle2i ScreenBounds;
+    uint32 RenderSignature;
+
     // TODO(casey): Generation index so we know how "up to date" this entity is.
 };
 
@@ -89,6 +94,28 @@ struct sim_entity_hash
 {
     sim_entity *Ptr;
     uint32 Index;
+    uint32 Generation;
+};
+
+// NOTE(casey): Outlives any one sim region, so starting a new region just
+// bumps Generation instead of clearing the table - any slot stamped with
+// an older generation reads as empty.
+struct sim_entity_hash_table
+{
+    uint32 Generation;
+
+    // NOTE(casey): Must be a power of two!
+    sim_entity_hash Entries[4096];
+};
+
+#define SIM_SWEEP_NO_ENTRY 0xFFFFFFFF
+struct sim_sweep_entry
+{
+    real32 MinX;
+    real32 MaxX;
+    real32 MinY;
+    real32 MaxY;
+    sim_entity *Entity;
 };
 
 struct sim_region
@@ -103,15 +130,33 @@ struct sim_region
     world_position Origin;
     rectangle3 Bounds;
     rectangle3 UpdatableBounds;
+
+    // NOTE(casey): Where the camera is relative to Origin.  Always zero,
+    // except in a persistent region, where the origin stays put while the
+    // camera moves around inside it.
+    v3 CameraOffset;
+
+    // NOTE(casey): Low entities at or past this index were made after the
+    // region was gathered.
+    uint32 GatheredLowEntityCount;
     
     uint32 MaxEntityCount;
     uint32 EntityCount;
     sim_entity *Entities;
 
+    // NOTE(casey): Sweep-and-prune broadphase for collision queries.  The
+    // XY bounds of every spatial entity, kept sorted on MinX.
+    uint32 SweepCount;
+    real32 SweepMaxDimX;
+    sim_sweep_entry *SweepEntries;
+    uint32 *CandidateBits;
+    sim_entity **Candidates;
+
     // TODO(casey): Do I really want a hash for this??
-    // NOTE(casey): Must be a power of two!
-    sim_entity_hash Hash[4096];
+    sim_entity_hash_table *Hash;
 };
 
+internal void UpdateSimSweep(sim_region *SimRegion, sim_entity *Entity);
+
 #define HANDMADE_SIM_REGION_H
 #endif
@@ -63,6 +63,210 @@ AreInSameChunk(world *World, world_position *A, world_position *B)
     return(Result);
 }
 
+#define INITIAL_CHUNK_HASH_COUNT 1024
+
+// NOTE(casey): What a chunk's entities look like in the page file.  They're
+// moved a block's worth at a time, through World->PageBuffer.
+struct world_paged_entity
+{
+    uint32 LowEntityIndex;
+    low_entity Low;
+};
+#define WORLD_PAGE_BATCH_COUNT ArrayCount(((world_entity_block *)0)->LowEntityIndex)
+
+// NOTE(casey): Chunks with more entities than this are never read ahead,
+// only paged in the slow way when they're needed
+#define WORLD_PREFETCH_ENTITY_COUNT (8*WORLD_PAGE_BATCH_COUNT)
+
+// NOTE(casey): How much the page file can grow past twice its size as of
+// the last compaction before it gets compacted again
+#if !defined(WORLD_PAGE_FILE_SLACK)
+#define WORLD_PAGE_FILE_SLACK Megabytes(4)
+#endif
+
+inline uint32
+GetChunkHashValue(int32 ChunkX, int32 ChunkY, int32 ChunkZ)
+{
+    // NOTE(casey): Worlds get laid out along diagonals and flip between two
+    // Zs, so anything linear clusters badly.  Each coordinate gets its own
+    // odd multiplier, and then the Murmur3 finalizer mixes every input bit
+    // into every output bit.
+    uint32 Result = (((uint32)ChunkX*0x8DA6B343) ^
+                     ((uint32)ChunkY*0xD8163841) ^
+                     ((uint32)ChunkZ*0xCB1AB31F));
+    Result ^= Result >> 16;
+    Result *= 0x85EBCA6B;
+    Result ^= Result >> 13;
+    Result *= 0xC2B2AE35;
+    Result ^= Result >> 16;
+
+    return(Result);
+}
+
+inline world_chunk_hash_slot *
+FindChunkSlot(world_chunk_hash_slot *Hash, uint32 HashCount,
+              int32 BrickX, int32 BrickY, int32 ChunkZ, uint32 *ProbeCount)
+{
+    // NOTE(casey): Returns the brick's slot, or the empty slot it would go in
+    uint32 HashMask = HashCount - 1;
+    uint32 HashSlot = GetChunkHashValue(BrickX, BrickY, ChunkZ) & HashMask;
+    world_chunk_hash_slot *Slot = Hash + HashSlot;
+    for(;;)
+    {
+        ++*ProbeCount;
+        if(!Slot->Brick ||
+           ((Slot->BrickX == BrickX) &&
+            (Slot->BrickY == BrickY) &&
+            (Slot->ChunkZ == ChunkZ)))
+        {
+            break;
+        }
+
+        HashSlot = (HashSlot + 1) & HashMask;
+        Slot = Hash + HashSlot;
+    }
+
+    return(Slot);
+}
+
+internal void
+AllocateChunkHash(memory_arena *Arena, world *World, uint32 NewHashCount)
+{
+    Assert((NewHashCount & (NewHashCount - 1)) == 0);
+    
+    world_chunk_hash_slot *NewHash = PushArray(Arena, NewHashCount, world_chunk_hash_slot);
+    ZeroSize(NewHashCount*sizeof(world_chunk_hash_slot), NewHash);
+
+    // TODO(casey): The old table can't be handed back to the arena, so it
+    // just sits there - this wants a real allocator eventually.
+    uint32 UnusedProbeCount = 0;
+    for(uint32 SlotIndex = 0;
+        SlotIndex < World->ChunkHashCount;
+        ++SlotIndex)
+    {
+        world_chunk_hash_slot *OldSlot = World->ChunkHash + SlotIndex;
+        if(OldSlot->Brick)
+        {
+            world_chunk_hash_slot *NewSlot = FindChunkSlot(NewHash, NewHashCount,
+                                                           OldSlot->BrickX, OldSlot->BrickY, OldSlot->ChunkZ,
+                                                           &UnusedProbeCount);
+            Assert(!NewSlot->Brick);
+            *NewSlot = *OldSlot;
+        }
+    }
+
+    World->ChunkHash = NewHash;
+    World->ChunkHashCount = NewHashCount;
+}
+
+inline int32
+GetBrickCoord(int32 ChunkCoord)
+{
+    // NOTE(casey): Arithmetic shift, so negative chunks round down too
+    int32 Result = ChunkCoord >> CHUNK_BRICK_SHIFT;
+    return(Result);
+}
+
+inline uint32
+GetChunkMortonIndex(int32 ChunkX, int32 ChunkY)
+{
+    // NOTE(casey): Where a chunk sits in its brick - the X and Y bits of its
+    // position in the brick, interleaved
+    uint32 X = (uint32)ChunkX & CHUNK_BRICK_MASK;
+    uint32 Y = (uint32)ChunkY & CHUNK_BRICK_MASK;
+    uint32 Result = (((X & 1) << 0) |
+                     ((Y & 1) << 1) |
+                     ((X & 2) << 1) |
+                     ((Y & 2) << 2));
+
+    return(Result);
+}
+
+inline uint32
+GetBrickChunkMask(int32 BrickX, int32 BrickY,
+                  int32 MinChunkX, int32 MinChunkY, int32 MaxChunkX, int32 MaxChunkY)
+{
+    // NOTE(casey): Which of a brick's chunks fall in the given range, as bits
+    // in Morton order.  Walking the set bits low to high walks the chunks
+    // in memory order.
+    uint32 Result = 0;
+    for(int32 Y = 0;
+        Y < CHUNK_BRICK_DIM;
+        ++Y)
+    {
+        int32 ChunkY = (BrickY << CHUNK_BRICK_SHIFT) + Y;
+        if((ChunkY >= MinChunkY) && (ChunkY <= MaxChunkY))
+        {
+            for(int32 X = 0;
+                X < CHUNK_BRICK_DIM;
+                ++X)
+            {
+                int32 ChunkX = (BrickX << CHUNK_BRICK_SHIFT) + X;
+                if((ChunkX >= MinChunkX) && (ChunkX <= MaxChunkX))
+                {
+                    Result |= (1 << GetChunkMortonIndex(X, Y));
+                }
+            }
+        }
+    }
+
+    return(Result);
+}
+
+inline world_chunk_brick *
+GetChunkBrick(world *World, int32 BrickX, int32 BrickY, int32 ChunkZ,
+              memory_arena *Arena = 0)
+{
+    ++World->ChunkLookupCount;
+    world_chunk_hash_slot *Slot = FindChunkSlot(World->ChunkHash, World->ChunkHashCount,
+                                                BrickX, BrickY, ChunkZ, &World->ChunkProbeCount);
+    world_chunk_brick *Brick = Slot->Brick;
+    if(!Brick && Arena)
+    {
+        if(2*(World->BrickCount + 1) > World->ChunkHashCount)
+        {
+            AllocateChunkHash(Arena, World, 2*World->ChunkHashCount);
+
+            uint32 UnusedProbeCount = 0;
+            Slot = FindChunkSlot(World->ChunkHash, World->ChunkHashCount,
+                                 BrickX, BrickY, ChunkZ, &UnusedProbeCount);
+        }
+
+        // NOTE(casey): Chunks in the brick are set up as they get created
+        Brick = PushStruct(Arena, world_chunk_brick);
+        Brick->BrickX = BrickX;
+        Brick->BrickY = BrickY;
+        Brick->ChunkZ = ChunkZ;
+        Brick->ChunkMask = 0;
+
+        Slot->BrickX = BrickX;
+        Slot->BrickY = BrickY;
+        Slot->ChunkZ = ChunkZ;
+        Slot->Brick = Brick;
+        ++World->BrickCount;
+    }
+
+    return(Brick);
+}
+
+inline void
+RemoveFromLRU(world_chunk *Chunk)
+{
+    Chunk->PrevLRU->NextLRU = Chunk->NextLRU;
+    Chunk->NextLRU->PrevLRU = Chunk->PrevLRU;
+    Chunk->PrevLRU = Chunk->NextLRU = 0;
+}
+
+inline void
+InsertAtFrontOfLRU(world *World, world_chunk *Chunk)
+{
+    world_chunk *Sentinel = &World->ChunkLRUSentinel;
+    Chunk->NextLRU = Sentinel->NextLRU;
+    Chunk->PrevLRU = Sentinel;
+    Chunk->NextLRU->PrevLRU = Chunk;
+    Chunk->PrevLRU->NextLRU = Chunk;
+}
+
 inline world_chunk *
 GetWorldChunk(world *World, int32 ChunkX, int32 ChunkY, int32 ChunkZ,
               memory_arena *Arena = 0)
@@ -73,47 +277,43 @@ GetWorldChunk(world *World, int32 ChunkX, int32 ChunkY, int32 ChunkZ,
     Assert(ChunkX < TILE_CHUNK_SAFE_MARGIN);
     Assert(ChunkY < TILE_CHUNK_SAFE_MARGIN);
     Assert(ChunkZ < TILE_CHUNK_SAFE_MARGIN);
-    
-    // TODO(casey): BETTER HASH FUNCTION!!!!
-    uint32 HashValue = 19*ChunkX + 7*ChunkY + 3*ChunkZ;
-    uint32 HashSlot = HashValue & (ArrayCount(World->ChunkHash) - 1);
-    Assert(HashSlot < ArrayCount(World->ChunkHash));
-    
-    world_chunk *Chunk = World->ChunkHash + HashSlot;
-    do
-    {
-        if((ChunkX == Chunk->ChunkX) &&
-           (ChunkY == Chunk->ChunkY) &&
-           (ChunkZ == Chunk->ChunkZ))
-        {            
-            break;
-        }
 
-        if(Arena && (Chunk->ChunkX != TILE_CHUNK_UNINITIALIZED) && (!Chunk->NextInHash))
-        {
-            Chunk->NextInHash = PushStruct(Arena, world_chunk);
-            Chunk = Chunk->NextInHash;
-            Chunk->ChunkX = TILE_CHUNK_UNINITIALIZED;
-        }
-        
-        if(Arena && (Chunk->ChunkX == TILE_CHUNK_UNINITIALIZED))
-        {
-            Chunk->ChunkX = ChunkX;
-            Chunk->ChunkY = ChunkY;
-            Chunk->ChunkZ = ChunkZ;
+    world_chunk *Chunk = 0;
+    world_chunk_brick *Brick = GetChunkBrick(World, GetBrickCoord(ChunkX), GetBrickCoord(ChunkY), ChunkZ,
+                                             Arena);
+    uint32 MortonIndex = GetChunkMortonIndex(ChunkX, ChunkY);
+    if(Brick && (Brick->ChunkMask & (1 << MortonIndex)))
+    {
+        Chunk = Brick->Chunks + MortonIndex;
+    }
+    else if(Brick && Arena)
+    {
+        Brick->ChunkMask |= (1 << MortonIndex);
+        Chunk = Brick->Chunks + MortonIndex;
+        Chunk->ChunkX = ChunkX;
+        Chunk->ChunkY = ChunkY;
+        Chunk->ChunkZ = ChunkZ;
+        Chunk->FirstBlock.EntityCount = 0;
+        Chunk->FirstBlock.Next = 0;
 
-            Chunk->NextInHash = 0;
-            break;
-        }
+        // NOTE(casey): New chunks start out resident, and empty
+        Chunk->Paged = false;
+        Chunk->PagedEntityCount = 0;
+        Chunk->PageOffset = 0;
+        Chunk->Prefetch = 0;
+        Chunk->LastUsedFrame = World->FrameIndex;
+        InsertAtFrontOfLRU(World, Chunk);
+        ++World->ResidentChunkCount;
 
-        Chunk = Chunk->NextInHash;
-    } while(Chunk);
+        ++World->ChunkCount;
+    }
     
     return(Chunk);
 }
 
 internal void
-InitializeWorld(world *World, real32 TileSideInMeters)
+InitializeWorld(memory_arena *Arena, world *World, real32 TileSideInMeters,
+                world_page_file_functions *PageFileFunctions, uint32 MaxResidentChunks)
 {
     World->TileSideInMeters = TileSideInMeters;
     World->ChunkDimInMeters = {(real32)TILES_PER_CHUNK*TileSideInMeters,
@@ -122,13 +322,59 @@ InitializeWorld(world *World, real32 TileSideInMeters)
     World->TileDepthInMeters = (real32)TileSideInMeters;
     World->FirstFree = 0;
 
-    for(uint32 ChunkIndex = 0;
-        ChunkIndex < ArrayCount(World->ChunkHash);
-        ++ChunkIndex)
+    World->PageFile = 0;
+    World->SparePageFile = 0;
+    World->ReadFromFile = PageFileFunctions->ReadFromFile;
+    World->WriteToFile = PageFileFunctions->WriteToFile;
+    if(PageFileFunctions->OpenScratchFile && World->ReadFromFile && World->WriteToFile)
+    {
+        // NOTE(casey): Both files get opened up front, since the platform may
+        // hand back an older copy of the world that only knows about these
+        World->PageFile = PageFileFunctions->OpenScratchFile("world.hhp");
+        World->SparePageFile = PageFileFunctions->OpenScratchFile("world_spare.hhp");
+    }
+    World->PageFileSize = 0;
+    World->CompactPageFileAt = WORLD_PAGE_FILE_SLACK;
+    World->PageBuffer = PushArray(Arena, WORLD_PAGE_BATCH_COUNT, world_paged_entity);
+
+    World->ReadAheadQueue = 0;
+    World->AddEntry = PageFileFunctions->AddEntry;
+    World->CompleteAllWork = PageFileFunctions->CompleteAllWork;
+    if(World->PageFile && World->AddEntry && World->CompleteAllWork)
     {
-        World->ChunkHash[ChunkIndex].ChunkX = TILE_CHUNK_UNINITIALIZED;
-        World->ChunkHash[ChunkIndex].FirstBlock.EntityCount = 0;
+        World->ReadAheadQueue = PageFileFunctions->ReadAheadQueue;
     }
+    for(uint32 PrefetchIndex = 0;
+        PrefetchIndex < ArrayCount(World->Prefetches);
+        ++PrefetchIndex)
+    {
+        world_chunk_prefetch *Prefetch = World->Prefetches + PrefetchIndex;
+        Prefetch->State = ChunkPrefetch_Unused;
+        Prefetch->Chunk = 0;
+        Prefetch->Entities = 0;
+        if(World->ReadAheadQueue)
+        {
+            Prefetch->Entities = PushArray(Arena, WORLD_PREFETCH_ENTITY_COUNT, world_paged_entity);
+        }
+    }
+
+    World->MaxResidentChunks = MaxResidentChunks;
+    World->ResidentChunkCount = 0;
+    World->FrameIndex = 0;
+    World->ChunkLRUSentinel.NextLRU = World->ChunkLRUSentinel.PrevLRU = &World->ChunkLRUSentinel;
+    World->FirstFreeLowEntity = 0;
+
+    World->ChunkHashCount = 0;
+    World->BrickCount = 0;
+    World->ChunkCount = 0;
+    World->ChunkHash = 0;
+    AllocateChunkHash(Arena, World, INITIAL_CHUNK_HASH_COUNT);
+    
+    World->ChunkLookupCount = 0;
+    World->ChunkProbeCount = 0;
+    World->ChunkPageInCount = 0;
+    World->ChunkPageOutCount = 0;
+    World->ChunkReadAheadCount = 0;
 }
 
 inline void
@@ -201,61 +447,675 @@ CenteredChunkPoint(uint32 ChunkX, uint32 ChunkY, uint32 ChunkZ)
 }
 
 inline void
-ChangeEntityLocationRaw(memory_arena *Arena, world *World, uint32 LowEntityIndex,
-                        world_position *OldP, world_position *NewP)
+SetChunkBlockSlot(low_entity **LowEntities, world_entity_block *Block, uint32 Index)
+{
+    low_entity *Low = LowEntities[Block->LowEntityIndex[Index]];
+    Low->ChunkBlock = Block;
+    Low->ChunkBlockIndex = Index;
+}
+
+inline void
+RefreshChunkBlockEntry(low_entity *Low)
+{
+    // NOTE(casey): Has to be called whenever a chunked entity's P or Dim
+    // changes without it changing chunks
+    world_entity_block *Block = Low->ChunkBlock;
+    if(Block)
+    {
+        Block->EntityOffset[Low->ChunkBlockIndex] = Low->P.Offset_;
+        Block->EntityRadius[Low->ChunkBlockIndex] = 0.5f*Low->Sim.Dim;
+    }
+}
+
+internal void
+MoveEntityBlock(low_entity **LowEntities, world_entity_block *Dest, world_entity_block *Source)
+{
+    // NOTE(casey): Every entity in the block has to be told where it went
+    *Dest = *Source;
+    for(uint32 Index = 0;
+        Index < Dest->EntityCount;
+        ++Index)
+    {
+        SetChunkBlockSlot(LowEntities, Dest, Index);
+    }
+}
+
+internal void
+RemoveEntityFromChunk(world *World, low_entity **LowEntities, world_chunk *Chunk,
+                      uint32 LowEntityIndex)
+{
+    // NOTE(casey): Pull the entity out of its entity block, by moving the
+    // last entity in the chunk into its slot
+    low_entity *Low = LowEntities[LowEntityIndex];
+    world_entity_block *Block = Low->ChunkBlock;
+    uint32 Index = Low->ChunkBlockIndex;
+    Assert(Block && (Index < Block->EntityCount));
+    Assert(Block->LowEntityIndex[Index] == LowEntityIndex);
+                
+    world_entity_block *FirstBlock = &Chunk->FirstBlock;
+    Assert(!Chunk->Paged);
+    Assert(FirstBlock->EntityCount > 0);
+    uint32 LastIndex = --FirstBlock->EntityCount;
+    Block->LowEntityIndex[Index] = FirstBlock->LowEntityIndex[LastIndex];
+    Block->EntityOffset[Index] = FirstBlock->EntityOffset[LastIndex];
+    Block->EntityRadius[Index] = FirstBlock->EntityRadius[LastIndex];
+    if((Block != FirstBlock) || (Index < FirstBlock->EntityCount))
+    {
+        SetChunkBlockSlot(LowEntities, Block, Index);
+    }
+                
+    if(FirstBlock->EntityCount == 0)
+    {
+        if(FirstBlock->Next)
+        {
+            world_entity_block *NextBlock = FirstBlock->Next;
+            MoveEntityBlock(LowEntities, FirstBlock, NextBlock);
+                                    
+            NextBlock->Next = World->FirstFree;
+            World->FirstFree = NextBlock;
+        }
+    }
+
+    Low->ChunkBlock = 0;
+    Low->ChunkBlockIndex = 0;
+}
+
+internal void
+AddEntityToChunk(memory_arena *Arena, world *World, low_entity **LowEntities, world_chunk *Chunk,
+                 uint32 LowEntityIndex)
+{
+    Assert(!Chunk->Paged);
+    world_entity_block *Block = &Chunk->FirstBlock;
+    if(Block->EntityCount == ArrayCount(Block->LowEntityIndex))
+    {
+        // NOTE(casey): We're out of room, get a new block!
+        world_entity_block *OldBlock = World->FirstFree;
+        if(OldBlock)
+        {
+            World->FirstFree = OldBlock->Next;
+        }
+        else
+        {
+            OldBlock = PushStruct(Arena, world_entity_block);
+        }
+            
+        MoveEntityBlock(LowEntities, OldBlock, Block);
+        Block->Next = OldBlock;
+        Block->EntityCount = 0;
+    }
+
+    Assert(Block->EntityCount < ArrayCount(Block->LowEntityIndex));
+    uint32 Index = Block->EntityCount++;
+    Block->LowEntityIndex[Index] = LowEntityIndex;
+    SetChunkBlockSlot(LowEntities, Block, Index);
+    RefreshChunkBlockEntry(LowEntities[LowEntityIndex]);
+}
+
+//
+// NOTE(casey): Residency
+//
+
+internal low_entity *
+AllocateLowEntity(memory_arena *Arena, world *World)
+{
+    low_entity *Result = World->FirstFreeLowEntity;
+    if(Result)
+    {
+        World->FirstFreeLowEntity = Result->NextFree;
+    }
+    else
+    {
+        Result = PushStruct(Arena, low_entity);
+    }
+
+    return(Result);
+}
+
+inline void
+FreeLowEntity(world *World, low_entity *Low)
+{
+    Low->NextFree = World->FirstFreeLowEntity;
+    World->FirstFreeLowEntity = Low;
+}
+
+internal uint32
+ReadPagedEntities(world *World, world_chunk *Chunk, uint32 FirstIndex)
+{
+    // NOTE(casey): Reads the next batch of a paged out chunk's entities into
+    // World->PageBuffer, without making the chunk resident.  Returns how
+    // many it read, which is 0 if the read failed - the record is left
+    // alone either way, so it can always be tried again.
+    Assert(FirstIndex < Chunk->PagedEntityCount);
+
+    uint32 Count = Minimum((uint32)WORLD_PAGE_BATCH_COUNT, Chunk->PagedEntityCount - FirstIndex);
+    uint64 Offset = Chunk->PageOffset + FirstIndex*sizeof(world_paged_entity);
+    if(!World->ReadFromFile(World->PageFile, Offset, Count*(uint32)sizeof(world_paged_entity),
+                            World->PageBuffer))
+    {
+        // TODO(casey): Logging
+        Count = 0;
+    }
+
+    return(Count);
+}
+
+internal void
+ReleaseChunkEntities(world *World, low_entity **LowEntities, world_chunk *Chunk)
+{
+    // NOTE(casey): Frees a chunk's entities and all but its first block,
+    // leaving it with no entities
+    world_entity_block *Block = &Chunk->FirstBlock;
+    while(Block)
+    {
+        for(uint32 Index = 0;
+            Index < Block->EntityCount;
+            ++Index)
+        {
+            uint32 LowEntityIndex = Block->LowEntityIndex[Index];
+            FreeLowEntity(World, LowEntities[LowEntityIndex]);
+            LowEntities[LowEntityIndex] = 0;
+        }
+
+        world_entity_block *Next = Block->Next;
+        if(Block != &Chunk->FirstBlock)
+        {
+            Block->Next = World->FirstFree;
+            World->FirstFree = Block;
+        }
+        Block = Next;
+    }
+    Chunk->FirstBlock.EntityCount = 0;
+    Chunk->FirstBlock.Next = 0;
+}
+
+inline bool32
+IsAnyChunkEntitySimming(low_entity **LowEntities, world_chunk *Chunk)
+{
+    bool32 Result = false;
+    for(world_entity_block *Block = &Chunk->FirstBlock;
+        !Result && Block;
+        Block = Block->Next)
+    {
+        for(uint32 Index = 0;
+            Index < Block->EntityCount;
+            ++Index)
+        {
+            if(IsSet(&LowEntities[Block->LowEntityIndex[Index]]->Sim, EntityFlag_Simming))
+            {
+                Result = true;
+                break;
+            }
+        }
+    }
+
+    return(Result);
+}
+
+internal bool32
+PageOutChunk(world *World, low_entity **LowEntities, world_chunk *Chunk)
+{
+    Assert(!Chunk->Paged);
+
+    uint32 EntityCount = 0;
+    for(world_entity_block *Block = &Chunk->FirstBlock;
+        Block;
+        Block = Block->Next)
+    {
+        EntityCount += Block->EntityCount;
+    }
+
+    // NOTE(casey): Always a new record, even if the chunk was paged out
+    // before - its old record may still be in use by a copy of the world
+    // the platform is going to restore.
+    uint64 PageOffset = World->PageFileSize;
+
+    // NOTE(casey): Blocks get written back to front, so that reading the
+    // record in order and adding each entity again rebuilds exactly the
+    // same blocks.  Only the first block is ever partly full.
+    bool32 Result = true;
+    uint32 EntityEnd = EntityCount;
+    for(world_entity_block *Block = &Chunk->FirstBlock;
+        Result && Block;
+        Block = Block->Next)
+    {
+        EntityEnd -= Block->EntityCount;
+        for(uint32 Index = 0;
+            Index < Block->EntityCount;
+            ++Index)
+        {
+            world_paged_entity *Paged = World->PageBuffer + Index;
+            Paged->LowEntityIndex = Block->LowEntityIndex[Index];
+            Paged->Low = *LowEntities[Paged->LowEntityIndex];
+            Assert(!IsSet(&Paged->Low.Sim, EntityFlag_Simming));
+        }
+
+        if(Block->EntityCount)
+        {
+            uint64 Offset = PageOffset + EntityEnd*sizeof(world_paged_entity);
+            Result = World->WriteToFile(World->PageFile, Offset,
+                                        Block->EntityCount*(uint32)sizeof(world_paged_entity),
+                                        World->PageBuffer);
+        }
+    }
+
+    if(Result)
+    {
+        ReleaseChunkEntities(World, LowEntities, Chunk);
+
+        Chunk->Paged = true;
+        Chunk->PagedEntityCount = EntityCount;
+        Chunk->PageOffset = PageOffset;
+        World->PageFileSize = PageOffset + EntityCount*sizeof(world_paged_entity);
+
+        RemoveFromLRU(Chunk);
+        --World->ResidentChunkCount;
+        ++World->ChunkPageOutCount;
+    }
+
+    return(Result);
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(PrefetchChunkWork)
+{
+    world_chunk_prefetch *Prefetch = (world_chunk_prefetch *)Data;
+
+    Prefetch->Succeeded = Prefetch->ReadFromFile(Prefetch->PageFile, Prefetch->PageOffset,
+                                                 Prefetch->EntityCount*(uint32)sizeof(world_paged_entity),
+                                                 Prefetch->Entities);
+
+    CompletePreviousWritesBeforeFutureWrites;
+
+    Prefetch->State = ChunkPrefetch_Loaded;
+}
+
+inline void
+ReleaseChunkPrefetch(world_chunk_prefetch *Prefetch)
+{
+    Assert(Prefetch->State == ChunkPrefetch_Loaded);
+    Prefetch->Chunk->Prefetch = 0;
+    Prefetch->Chunk = 0;
+    Prefetch->State = ChunkPrefetch_Unused;
+}
+
+inline bool32
+IsAnyChunkPrefetchQueued(world *World)
+{
+    bool32 Result = false;
+    for(uint32 PrefetchIndex = 0;
+        PrefetchIndex < ArrayCount(World->Prefetches);
+        ++PrefetchIndex)
+    {
+        if(World->Prefetches[PrefetchIndex].State == ChunkPrefetch_Queued)
+        {
+            Result = true;
+            break;
+        }
+    }
+
+    return(Result);
+}
+
+internal void
+PrefetchWorldChunks(world *World, world_position Center, rectangle3 Bounds)
+{
+    // NOTE(casey): Queues reads for the paged out chunks in Bounds, so they're
+    // already in memory by the time a sim region there wants them.  Reads
+    // for chunks that weren't asked for again this time are the first to be
+    // dropped when more room is needed.
+    if(World->ReadAheadQueue)
+    {
+        world_position MinChunkP = MapIntoChunkSpace(World, Center, GetMinCorner(Bounds));
+        world_position MaxChunkP = MapIntoChunkSpace(World, Center, GetMaxCorner(Bounds));
+        for(int32 ChunkZ = MinChunkP.ChunkZ;
+            ChunkZ <= MaxChunkP.ChunkZ;
+            ++ChunkZ)
+        {
+            for(int32 ChunkY = MinChunkP.ChunkY;
+                ChunkY <= MaxChunkP.ChunkY;
+                ++ChunkY)
+            {
+                for(int32 ChunkX = MinChunkP.ChunkX;
+                    ChunkX <= MaxChunkP.ChunkX;
+                    ++ChunkX)
+                {
+                    world_chunk *Chunk = GetWorldChunk(World, ChunkX, ChunkY, ChunkZ);
+                    if(Chunk && Chunk->Prefetch)
+                    {
+                        Chunk->Prefetch->WantedFrame = World->FrameIndex;
+                    }
+                    else if(Chunk && Chunk->Paged && Chunk->PagedEntityCount &&
+                            (Chunk->PagedEntityCount <= WORLD_PREFETCH_ENTITY_COUNT))
+                    {
+                        world_chunk_prefetch *Prefetch = 0;
+                        for(uint32 PrefetchIndex = 0;
+                            PrefetchIndex < ArrayCount(World->Prefetches);
+                            ++PrefetchIndex)
+                        {
+                            world_chunk_prefetch *Test = World->Prefetches + PrefetchIndex;
+                            if(Test->State == ChunkPrefetch_Unused)
+                            {
+                                Prefetch = Test;
+                                break;
+                            }
+                            else if((Test->State == ChunkPrefetch_Loaded) &&
+                                    (Test->WantedFrame != World->FrameIndex))
+                            {
+                                CompletePreviousReadsBeforeFutureReads;
+                                ReleaseChunkPrefetch(Test);
+                                Prefetch = Test;
+                                break;
+                            }
+                        }
+
+                        if(Prefetch)
+                        {
+                            Prefetch->State = ChunkPrefetch_Queued;
+                            Prefetch->Chunk = Chunk;
+                            Prefetch->WantedFrame = World->FrameIndex;
+                            Prefetch->ReadFromFile = World->ReadFromFile;
+                            Prefetch->PageFile = World->PageFile;
+                            Prefetch->PageOffset = Chunk->PageOffset;
+                            Prefetch->EntityCount = Chunk->PagedEntityCount;
+                            Prefetch->Succeeded = false;
+                            Chunk->Prefetch = Prefetch;
+                            World->AddEntry(World->ReadAheadQueue, PrefetchChunkWork, Prefetch);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+inline void
+AddPagedEntity(memory_arena *Arena, world *World, low_entity **LowEntities, world_chunk *Chunk,
+               world_paged_entity *Paged)
+{
+    Assert(!LowEntities[Paged->LowEntityIndex]);
+
+    low_entity *Low = AllocateLowEntity(Arena, World);
+    *Low = Paged->Low;
+    LowEntities[Paged->LowEntityIndex] = Low;
+    AddEntityToChunk(Arena, World, LowEntities, Chunk, Paged->LowEntityIndex);
+}
+
+internal bool32
+PageInChunk(memory_arena *Arena, world *World, low_entity **LowEntities, world_chunk *Chunk)
+{
+    Assert(Chunk->Paged);
+    Assert((Chunk->FirstBlock.EntityCount == 0) && !Chunk->FirstBlock.Next);
+
+    bool32 Result = true;
+    Chunk->Paged = false;
+
+    bool32 Prefetched = false;
+    world_chunk_prefetch *Prefetch = Chunk->Prefetch;
+    if(Prefetch)
+    {
+        if(Prefetch->State == ChunkPrefetch_Queued)
+        {
+            // NOTE(casey): Wanted before the read got done, so there's
+            // nothing for it but to wait
+            World->CompleteAllWork(World->ReadAheadQueue);
+        }
+        CompletePreviousReadsBeforeFutureReads;
+
+        if(Prefetch->Succeeded)
+        {
+            for(uint32 Index = 0;
+                Index < Prefetch->EntityCount;
+                ++Index)
+            {
+                AddPagedEntity(Arena, World, LowEntities, Chunk, Prefetch->Entities + Index);
+            }
+            Prefetched = true;
+            ++World->ChunkReadAheadCount;
+        }
+        ReleaseChunkPrefetch(Prefetch);
+    }
+
+    for(uint32 FirstIndex = 0;
+        !Prefetched && Result && (FirstIndex < Chunk->PagedEntityCount);
+        FirstIndex += (uint32)WORLD_PAGE_BATCH_COUNT)
+    {
+        uint32 Count = ReadPagedEntities(World, Chunk, FirstIndex);
+        Result = (Count != 0);
+        for(uint32 Index = 0;
+            Index < Count;
+            ++Index)
+        {
+            AddPagedEntity(Arena, World, LowEntities, Chunk, World->PageBuffer + Index);
+        }
+    }
+
+    if(Result)
+    {
+        Chunk->PagedEntityCount = 0;
+
+        ++World->ResidentChunkCount;
+        ++World->ChunkPageInCount;
+    }
+    else
+    {
+        // NOTE(casey): Back out whatever did get read, so the chunk is paged
+        // out exactly like it was before
+        ReleaseChunkEntities(World, LowEntities, Chunk);
+        Chunk->Paged = true;
+    }
+
+    return(Result);
+}
+
+internal bool32
+UseWorldChunk(memory_arena *Arena, world *World, low_entity **LowEntities, world_chunk *Chunk)
+{
+    // NOTE(casey): Anything that's going to look at or change a chunk's
+    // entities has to come through here first, so it's resident and won't
+    // get paged out until next frame at the earliest.  Returns false if the
+    // chunk couldn't be paged back in, in which case it's still paged out.
+    bool32 Result = true;
+    if(Chunk->Paged)
+    {
+        Result = PageInChunk(Arena, World, LowEntities, Chunk);
+    }
+    else
+    {
+        RemoveFromLRU(Chunk);
+    }
+
+    if(Result)
+    {
+        InsertAtFrontOfLRU(World, Chunk);
+        Chunk->LastUsedFrame = World->FrameIndex;
+    }
+
+    return(Result);
+}
+
+internal void
+UseWorldChunkForInsert(memory_arena *Arena, world *World, low_entity **LowEntities, world_chunk *Chunk)
+{
+    // NOTE(casey): An entity that's moving into a chunk has to end up in it,
+    // so if the chunk can't be read back, its paged entities are written off
+    if(!UseWorldChunk(Arena, World, LowEntities, Chunk))
+    {
+        // NOTE(casey): This loses entities for good, so it should never go
+        // unnoticed in a debug build
+        // TODO(casey): Logging
+        InvalidCodePath;
+        Chunk->Paged = false;
+        Chunk->PagedEntityCount = 0;
+        ++World->ResidentChunkCount;
+
+        InsertAtFrontOfLRU(World, Chunk);
+        Chunk->LastUsedFrame = World->FrameIndex;
+    }
+}
+
+internal void
+CompactPageFile(world *World)
+{
+    // NOTE(casey): Copies every paged out chunk's record into the spare page
+    // file, back to back, then swaps the files.  The chunks are only pointed
+    // at their new records once everything has been copied, so if anything
+    // fails the old page file is left exactly as it was.
+    bool32 Copied = true;
+    uint64 CompactedSize = 0;
+    for(uint32 SlotIndex = 0;
+        Copied && (SlotIndex < World->ChunkHashCount);
+        ++SlotIndex)
+    {
+        world_chunk_brick *Brick = World->ChunkHash[SlotIndex].Brick;
+        for(uint32 ChunkIndex = 0;
+            Copied && Brick && (ChunkIndex < ArrayCount(Brick->Chunks));
+            ++ChunkIndex)
+        {
+            world_chunk *Chunk = Brick->Chunks + ChunkIndex;
+            if((Brick->ChunkMask & (1 << ChunkIndex)) && Chunk->Paged)
+            {
+                for(uint32 FirstIndex = 0;
+                    Copied && (FirstIndex < Chunk->PagedEntityCount);
+                    FirstIndex += (uint32)WORLD_PAGE_BATCH_COUNT)
+                {
+                    uint32 Count = ReadPagedEntities(World, Chunk, FirstIndex);
+                    uint64 Offset = CompactedSize + FirstIndex*sizeof(world_paged_entity);
+                    Copied = (Count &&
+                              World->WriteToFile(World->SparePageFile, Offset,
+                                                 Count*(uint32)sizeof(world_paged_entity),
+                                                 World->PageBuffer));
+                }
+                CompactedSize += Chunk->PagedEntityCount*sizeof(world_paged_entity);
+            }
+        }
+    }
+
+    if(Copied)
+    {
+        CompactedSize = 0;
+        for(uint32 SlotIndex = 0;
+            SlotIndex < World->ChunkHashCount;
+            ++SlotIndex)
+        {
+            world_chunk_brick *Brick = World->ChunkHash[SlotIndex].Brick;
+            for(uint32 ChunkIndex = 0;
+                Brick && (ChunkIndex < ArrayCount(Brick->Chunks));
+                ++ChunkIndex)
+            {
+                world_chunk *Chunk = Brick->Chunks + ChunkIndex;
+                if((Brick->ChunkMask & (1 << ChunkIndex)) && Chunk->Paged)
+                {
+                    Chunk->PageOffset = CompactedSize;
+                    CompactedSize += Chunk->PagedEntityCount*sizeof(world_paged_entity);
+                }
+            }
+        }
+
+        platform_file_handle *OldPageFile = World->PageFile;
+        World->PageFile = World->SparePageFile;
+        World->SparePageFile = OldPageFile;
+        World->PageFileSize = CompactedSize;
+    }
+    else
+    {
+        // TODO(casey): Logging
+    }
+}
+
+internal void
+UpdateWorldResidency(world *World, low_entity **LowEntities, bool32 AllowCompaction)
+{
+    // NOTE(casey): Called once per frame, when nothing is simming.
+    // Compaction moves records around, so it has to be held off while the
+    // platform might hand back a copy of the world that still points at the
+    // old ones.
+    if(World->PageFile)
+    {
+        world_chunk *Sentinel = &World->ChunkLRUSentinel;
+        while(World->ResidentChunkCount > World->MaxResidentChunks)
+        {
+            world_chunk *Chunk = Sentinel->PrevLRU;
+            if((Chunk == Sentinel) || (Chunk->LastUsedFrame == World->FrameIndex))
+            {
+                // NOTE(casey): Everything left was used this frame, so this
+                // frame just runs over budget
+                break;
+            }
+
+            if(IsAnyChunkEntitySimming(LowEntities, Chunk))
+            {
+                // NOTE(casey): A persistent sim region can be holding on to
+                // entities from chunks it isn't over (ones it pulled in
+                // through references, or made itself), and their stored
+                // copies have to be there when it writes them back.  So the
+                // chunk counts as used.
+                RemoveFromLRU(Chunk);
+                InsertAtFrontOfLRU(World, Chunk);
+                Chunk->LastUsedFrame = World->FrameIndex;
+            }
+            else if(!PageOutChunk(World, LowEntities, Chunk))
+            {
+                // TODO(casey): Logging
+                break;
+            }
+        }
+
+        if(AllowCompaction && World->SparePageFile &&
+           (World->PageFileSize > World->CompactPageFileAt) &&
+           !IsAnyChunkPrefetchQueued(World))
+        {
+            // NOTE(casey): If compaction fails, this still backs the next
+            // attempt off until the file has doubled again
+            CompactPageFile(World);
+            World->CompactPageFileAt = 2*World->PageFileSize + WORLD_PAGE_FILE_SLACK;
+        }
+    }
+
+    ++World->FrameIndex;
+}
+
+inline void
+SetEntityP(low_entity *LowEntity, world_position *NewP)
+{
+    if(NewP)
+    {
+        LowEntity->P = *NewP;
+        ClearFlags(&LowEntity->Sim, EntityFlag_Nonspatial);
+    }
+    else
+    {
+        LowEntity->P = NullPosition();
+        AddFlags(&LowEntity->Sim, EntityFlag_Nonspatial);
+    }
+}
+
+inline void
+ChangeEntityLocationRaw(memory_arena *Arena, world *World, low_entity **LowEntities,
+                        uint32 LowEntityIndex, world_position *OldP, world_position *NewP)
 {
     // TODO(casey): If this moves an entity into the camera bounds, should it automatically
     // go into the high set immediately?
     // If it moves _out_ of the camera bounds, should it be removed from the high set
     // immediately?
 
+    // NOTE(casey): The entity's P has to be NewP already, since that's
+    // what its chunk block entry gets filled in from
     Assert(!OldP || IsValid(*OldP));
     Assert(!NewP || IsValid(*NewP));
-    
+
     if(OldP && NewP && AreInSameChunk(World, OldP, NewP))
     {
         // NOTE(casey): Leave entity where it is
+        RefreshChunkBlockEntry(LowEntities[LowEntityIndex]);
     }
     else
     {
         if(OldP)
         {
-            // NOTE(casey): Pull the entity out of its old entity block
             world_chunk *Chunk = GetWorldChunk(World, OldP->ChunkX, OldP->ChunkY, OldP->ChunkZ);
             Assert(Chunk);            
             if(Chunk)
             {
-                bool32 NotFound = true;
-                world_entity_block *FirstBlock = &Chunk->FirstBlock;
-                for(world_entity_block *Block = FirstBlock;
-                    Block && NotFound;
-                    Block = Block->Next)
-                {
-                    for(uint32 Index = 0;
-                        (Index < Block->EntityCount) && NotFound;
-                        ++Index)
-                    {
-                        if(Block->LowEntityIndex[Index] == LowEntityIndex)
-                        {
-                            Assert(FirstBlock->EntityCount > 0);
-                            Block->LowEntityIndex[Index] =
-                                FirstBlock->LowEntityIndex[--FirstBlock->EntityCount];
-                            if(FirstBlock->EntityCount == 0)
-                            {
-                                if(FirstBlock->Next)
-                                {
-                                    world_entity_block *NextBlock = FirstBlock->Next;
-                                    *FirstBlock = *NextBlock;
-                                    
-                                    NextBlock->Next = World->FirstFree;
-                                    World->FirstFree = NextBlock;
-                                }
-                            }
-
-                            NotFound = false;
-                        }
-                    }    
-                }
+                RemoveEntityFromChunk(World, LowEntities, Chunk, LowEntityIndex);
             }
         }
 
@@ -264,43 +1124,28 @@ ChangeEntityLocationRaw(memory_arena *Arena, world *World, uint32 LowEntityIndex
             // NOTE(casey): Insert the entity into its new entity block
             world_chunk *Chunk = GetWorldChunk(World, NewP->ChunkX, NewP->ChunkY, NewP->ChunkZ, Arena);
             Assert(Chunk);
-        
-            world_entity_block *Block = &Chunk->FirstBlock;
-            if(Block->EntityCount == ArrayCount(Block->LowEntityIndex))
-            {
-                // NOTE(casey): We're out of room, get a new block!
-                world_entity_block *OldBlock = World->FirstFree;
-                if(OldBlock)
-                {
-                    World->FirstFree = OldBlock->Next;
-                }
-                else
-                {
-                    OldBlock = PushStruct(Arena, world_entity_block);
-                }
-            
-                *OldBlock = *Block;
-                Block->Next = OldBlock;
-                Block->EntityCount = 0;
-            }
-
-            Assert(Block->EntityCount < ArrayCount(Block->LowEntityIndex));
-            Block->LowEntityIndex[Block->EntityCount++] = LowEntityIndex;
+            UseWorldChunkForInsert(Arena, World, LowEntities, Chunk);
+            AddEntityToChunk(Arena, World, LowEntities, Chunk, LowEntityIndex);
         }
     }
 }
 
 internal void
-ChangeEntityLocation(memory_arena *Arena, world *World,
-                     uint32 LowEntityIndex, low_entity *LowEntity,
-                     world_position NewPInit)
+ChangeEntityLocation(memory_arena *Arena, world *World, low_entity **LowEntities,
+                     uint32 LowEntityIndex, world_position NewPInit)
 {
+    low_entity *LowEntity = LowEntities[LowEntityIndex];
+
+    // NOTE(casey): P is only ever valid while the entity is in a chunk.  The
+    // Nonspatial flag can't be used for this, since EndSim has already
+    // copied the new flags back by the time the entity gets moved.
+    world_position OldPCopy = LowEntity->P;
     world_position *OldP = 0;
     world_position *NewP = 0;
 
-    if(!IsSet(&LowEntity->Sim, EntityFlag_Nonspatial) && IsValid(LowEntity->P))
+    if(IsValid(OldPCopy))
     {        
-        OldP = &LowEntity->P;
+        OldP = &OldPCopy;
     }
     
     if(IsValid(NewPInit))
@@ -308,17 +1153,122 @@ ChangeEntityLocation(memory_arena *Arena, world *World,
         NewP = &NewPInit;
     }
     
-    ChangeEntityLocationRaw(Arena, World, LowEntityIndex, OldP, NewP);
+    SetEntityP(LowEntity, NewP);
+    ChangeEntityLocationRaw(Arena, World, LowEntities, LowEntityIndex, OldP, NewP);
+}
 
-    if(NewP)
+//
+// NOTE(casey): Batched relocation
+//
+
+inline bool32
+IsInEarlierChunk(entity_relocation *A, entity_relocation *B)
+{
+    bool32 Result = ((A->ChunkZ < B->ChunkZ) ||
+                     ((A->ChunkZ == B->ChunkZ) &&
+                      ((A->ChunkY < B->ChunkY) ||
+                       ((A->ChunkY == B->ChunkY) && (A->ChunkX < B->ChunkX)))));
+    return(Result);
+}
+
+inline bool32
+AreInSameChunk(entity_relocation *A, entity_relocation *B)
+{
+    bool32 Result = ((A->ChunkX == B->ChunkX) &&
+                     (A->ChunkY == B->ChunkY) &&
+                     (A->ChunkZ == B->ChunkZ));
+    return(Result);
+}
+
+internal entity_relocation *
+SortRelocationsByChunk(uint32 Count, entity_relocation *First, entity_relocation *Temp)
+{
+    // NOTE(casey): Bottom-up merge sort, so it's stable - entities going to
+    // the same chunk keep the order they were queued in.  Returns whichever
+    // of the two buffers the result ended up in.
+    entity_relocation *Source = First;
+    entity_relocation *Dest = Temp;
+    for(uint32 RunLength = 1;
+        RunLength < Count;
+        RunLength *= 2)
     {
-        LowEntity->P = *NewP;
-        ClearFlags(&LowEntity->Sim, EntityFlag_Nonspatial);
+        for(uint32 RunStart = 0;
+            RunStart < Count;
+            RunStart += 2*RunLength)
+        {
+            uint32 Middle = Minimum(RunStart + RunLength, Count);
+            uint32 End = Minimum(RunStart + 2*RunLength, Count);
+            
+            uint32 ReadA = RunStart;
+            uint32 ReadB = Middle;
+            for(uint32 WriteIndex = RunStart;
+                WriteIndex < End;
+                ++WriteIndex)
+            {
+                if((ReadB >= End) ||
+                   ((ReadA < Middle) && !IsInEarlierChunk(Source + ReadB, Source + ReadA)))
+                {
+                    Dest[WriteIndex] = Source[ReadA++];
+                }
+                else
+                {
+                    Dest[WriteIndex] = Source[ReadB++];
+                }
+            }
+        }
+
+        entity_relocation *Swap = Source;
+        Source = Dest;
+        Dest = Swap;
     }
-    else
+
+    return(Source);
+}
+
+internal void
+ApplyEntityRelocations(memory_arena *WorldArena, world *World, low_entity **LowEntities,
+                       uint32 RemovalCount, entity_relocation *Removals,
+                       uint32 InsertionCount, entity_relocation *Insertions,
+                       entity_relocation *Temp)
+{
+    // NOTE(casey): Everything leaving a chunk goes first and everything
+    // entering one second, each grouped by chunk, so it's one hash lookup
+    // per chunk touched rather than two per entity moved.  Temp has to hold
+    // the larger of the two lists.
+    Removals = SortRelocationsByChunk(RemovalCount, Removals, Temp);
+    world_chunk *Chunk = 0;
+    for(uint32 RemovalIndex = 0;
+        RemovalIndex < RemovalCount;
+        ++RemovalIndex)
     {
-        LowEntity->P = NullPosition();
-        AddFlags(&LowEntity->Sim, EntityFlag_Nonspatial);
+        entity_relocation *Removal = Removals + RemovalIndex;
+        if((RemovalIndex == 0) || !AreInSameChunk(Removal, Removal - 1))
+        {
+            Chunk = GetWorldChunk(World, Removal->ChunkX, Removal->ChunkY, Removal->ChunkZ);
+            Assert(Chunk);
+        }
+        
+        if(Chunk)
+        {
+            RemoveEntityFromChunk(World, LowEntities, Chunk, Removal->LowEntityIndex);
+        }
+    }
+    
+    Insertions = SortRelocationsByChunk(InsertionCount, Insertions, Temp);
+    for(uint32 InsertionIndex = 0;
+        InsertionIndex < InsertionCount;
+        ++InsertionIndex)
+    {
+        entity_relocation *Insertion = Insertions + InsertionIndex;
+        if((InsertionIndex == 0) || !AreInSameChunk(Insertion, Insertion - 1))
+        {
+            Chunk = GetWorldChunk(World, Insertion->ChunkX, Insertion->ChunkY, Insertion->ChunkZ,
+                                  WorldArena);
+            Assert(Chunk);
+            UseWorldChunkForInsert(WorldArena, World, LowEntities, Chunk);
+        }
+        
+        AddEntityToChunk(WorldArena, World, LowEntities, Chunk, Insertion->LowEntityIndex);
     }
 }
 
@@ -28,19 +28,122 @@ struct world_entity_block
 {
     uint32 EntityCount;
     uint32 LowEntityIndex[16];
+
+    // NOTE(casey): Copies of each entity's chunk offset and half its Dim,
+    // kept next to the indices so the sim region gather can cull against
+    // them without touching the entities themselves.
+    v3 EntityOffset[16];
+    v3 EntityRadius[16];
+    
     world_entity_block *Next;
 };
 
+struct world_chunk_prefetch;
 struct world_chunk
 {
     int32 ChunkX;
     int32 ChunkY;
     int32 ChunkZ;
 
+    // NOTE(casey): A paged out chunk has no entity blocks - its entities
+    // sit in the page file at PageOffset until something touches it again.
+    bool32 Paged;
+    uint32 PagedEntityCount;
+    uint64 PageOffset;
+
+    // NOTE(casey): Set while a paged out chunk's record is being (or has
+    // been) read ahead of time
+    world_chunk_prefetch *Prefetch;
+
+    // NOTE(casey): Only resident chunks are in the LRU
+    uint32 LastUsedFrame;
+    world_chunk *PrevLRU;
+    world_chunk *NextLRU;
+
     // TODO(casey): Profile this and determine if a pointer would be better here!
     world_entity_block FirstBlock;
-    
-    world_chunk *NextInHash;
+};
+
+struct low_entity;
+struct world_paged_entity;
+
+// NOTE(casey): The platform's scratch file services, which are all the
+// world needs from it.  If any of the file functions are 0, the whole world
+// stays resident.  If there's no ReadAheadQueue, chunks are only ever read
+// right when they're needed.
+struct world_page_file_functions
+{
+    platform_open_scratch_file *OpenScratchFile;
+    platform_read_from_file *ReadFromFile;
+    platform_write_to_file *WriteToFile;
+
+    platform_work_queue *ReadAheadQueue;
+    platform_add_entry *AddEntry;
+    platform_complete_all_work *CompleteAllWork;
+};
+
+enum chunk_prefetch_state
+{
+    ChunkPrefetch_Unused,
+    ChunkPrefetch_Queued,
+    ChunkPrefetch_Loaded,
+};
+
+struct world_chunk_prefetch
+{
+    uint32 volatile State;
+    world_chunk *Chunk;
+    uint32 WantedFrame;
+
+    // NOTE(casey): Copied out of the world and the chunk when the read gets
+    // queued, so the work never has to look at either
+    platform_read_from_file *ReadFromFile;
+    platform_file_handle *PageFile;
+    uint64 PageOffset;
+    uint32 EntityCount;
+
+    bool32 Succeeded;
+    world_paged_entity *Entities;
+};
+#define WORLD_PREFETCH_COUNT 32
+
+// NOTE(casey): Chunks are allocated in 4x4 bricks on each Z, stored in
+// Z-order (Morton order) inside the brick, so chunks that are near each
+// other in the world are near each other in memory too.
+#define CHUNK_BRICK_SHIFT 2
+#define CHUNK_BRICK_DIM (1 << CHUNK_BRICK_SHIFT)
+#define CHUNK_BRICK_MASK (CHUNK_BRICK_DIM - 1)
+#define CHUNK_BRICK_CHUNK_COUNT (CHUNK_BRICK_DIM*CHUNK_BRICK_DIM)
+
+struct world_chunk_brick
+{
+    int32 BrickX;
+    int32 BrickY;
+    int32 ChunkZ;
+
+    // NOTE(casey): Bit N is set if Chunks[N] has been created
+    uint32 ChunkMask;
+    world_chunk Chunks[CHUNK_BRICK_CHUNK_COUNT];
+};
+
+struct world_chunk_hash_slot
+{
+    // NOTE(casey): The coordinates are copied in here so probing never has
+    // to touch the brick itself.  Brick is 0 for an empty slot.
+    int32 BrickX;
+    int32 BrickY;
+    int32 ChunkZ;
+    world_chunk_brick *Brick;
+};
+
+struct entity_relocation
+{
+    // NOTE(casey): Queued by EndSim, so chunk moves can be applied one chunk
+    // at a time instead of one entity at a time
+    int32 ChunkX;
+    int32 ChunkY;
+    int32 ChunkZ;
+    uint32 LowEntityIndex;
 };
 
 struct world
@@ -51,10 +154,54 @@ struct world
 
     world_entity_block *FirstFree;
 
-    // TODO(casey): WorldChunkHash should probably switch to pointers IF
-    // tile entity blocks continue to be stored en masse directly in the tile chunk!
-    // NOTE(casey): A the moment, this must be a power of two!
-    world_chunk ChunkHash[4096];
+    // NOTE(casey): Bricks, open addressed with linear probing.
+    // ChunkHashCount is always a power of two, and the table doubles before
+    // it gets more than half full.  Bricks (and so chunks) never move, only
+    // their slots do.
+    uint32 ChunkHashCount;
+    uint32 BrickCount;
+    uint32 ChunkCount;
+    world_chunk_hash_slot *ChunkHash;
+
+    // NOTE(casey): Residency.  Once more than MaxResidentChunks have their
+    // entities in memory, the least recently used ones that weren't touched
+    // this frame get their entities written out to the page file.  The
+    // world_chunk records themselves (and the bricks and hash) are never
+    // paged.  With no page file, everything just stays resident.
+    // Records are only ever appended to the page file, never rewritten, so
+    // a copy of the world from earlier on (looped playback) still finds its
+    // records intact.  Once the file gets past CompactPageFileAt, the live
+    // records are copied into SparePageFile and the two files swap.
+    platform_file_handle *PageFile;
+    platform_file_handle *SparePageFile;
+    platform_read_from_file *ReadFromFile;
+    platform_write_to_file *WriteToFile;
+    uint64 PageFileSize;
+    uint64 CompactPageFileAt;
+    world_paged_entity *PageBuffer;
+
+    // NOTE(casey): Paged out chunks near the camera get their records read
+    // on ReadAheadQueue ahead of time, so the sim region that ends up
+    // wanting them doesn't have to wait on the file.  Compaction is held off
+    // while any of those reads are still going.
+    platform_work_queue *ReadAheadQueue;
+    platform_add_entry *AddEntry;
+    platform_complete_all_work *CompleteAllWork;
+    world_chunk_prefetch Prefetches[WORLD_PREFETCH_COUNT];
+
+    uint32 MaxResidentChunks;
+    uint32 ResidentChunkCount;
+    uint32 FrameIndex;
+    world_chunk ChunkLRUSentinel;
+
+    low_entity *FirstFreeLowEntity;
+
+    // NOTE(casey): Reset by whoever reports them
+    uint32 ChunkLookupCount;
+    uint32 ChunkProbeCount;
+    uint32 ChunkPageInCount;
+    uint32 ChunkPageOutCount;
+    uint32 ChunkReadAheadCount;
 };
 
 #define HANDMADE_WORLD_H
@@ -0,0 +1,234 @@
+/* ========================================================================
+   $File: $
+   $Date: $
+   $Revision: $
+   $Creator: Casey Muratori $
+   $Notice: (C) Copyright 2015 by Molly Rocket, Inc. All Rights Reserved. $
+   ======================================================================== */
+
+/*
+  NOTE(casey): Offline packer.  Run it from the data directory - it reads the
+  loose test BMPs and writes test.hha next to them, with every bitmap already
+  swizzled, premultiplied and span-encoded so the game can use it in place.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "handmade_platform.h"
+#include "handmade_intrinsics.h"
+#include "handmade_file_formats.h"
+#include "handmade_bitmap_spans.cpp"
+#include "handmade_bmp.cpp"
+
+struct loaded_bitmap
+{
+    int32 Width;
+    int32 Height;
+    uint32 *Pixels;
+
+    uint32 SpanCount;
+    uint32 *RowFirstSpan;
+    bitmap_span *Spans;
+};
+
+struct entire_file
+{
+    uint32 ContentsSize;
+    void *Contents;
+};
+
+internal entire_file
+ReadEntireFile(char *FileName)
+{
+    entire_file Result = {};
+
+    FILE *In = fopen(FileName, "rb");
+    if(In)
+    {
+        fseek(In, 0, SEEK_END);
+        Result.ContentsSize = (uint32)ftell(In);
+        fseek(In, 0, SEEK_SET);
+
+        Result.Contents = malloc(Result.ContentsSize);
+        fread(Result.Contents, Result.ContentsSize, 1, In);
+        fclose(In);
+    }
+    else
+    {
+        printf("ERROR: Cannot open file %s.\n", FileName);
+    }
+
+    return(Result);
+}
+
+internal loaded_bitmap
+LoadBMP(char *FileName)
+{
+    loaded_bitmap Result = {};
+
+    entire_file ReadResult = ReadEntireFile(FileName);
+    if(ReadResult.ContentsSize != 0)
+    {
+        bitmap_header *Header = (bitmap_header *)ReadResult.Contents;
+        Result.Pixels = ConvertBMPPixels(Header);
+        Result.Width = Header->Width;
+        Result.Height = Header->Height;
+
+        Assert(Result.Height >= 0);
+        // NOTE(casey): Span tables, same as BuildBitmapSpans in the game
+        Result.RowFirstSpan = (uint32 *)malloc((Result.Height + 1)*sizeof(uint32));
+        uint32 *Row = Result.Pixels;
+        for(int32 Y = 0;
+            Y < Result.Height;
+            ++Y)
+        {
+            Result.RowFirstSpan[Y] = Result.SpanCount;
+            Result.SpanCount += BuildRowSpans(Row, Result.Width, 0);
+            Row += Result.Width;
+        }
+        Result.RowFirstSpan[Result.Height] = Result.SpanCount;
+
+        Result.Spans = (bitmap_span *)malloc(Result.SpanCount*sizeof(bitmap_span));
+        Row = Result.Pixels;
+        for(int32 Y = 0;
+            Y < Result.Height;
+            ++Y)
+        {
+            BuildRowSpans(Row, Result.Width, Result.Spans + Result.RowFirstSpan[Y]);
+            Row += Result.Width;
+        }
+    }
+
+    return(Result);
+}
+
+internal uint64
+AlignOffset(uint64 Offset, uint64 Alignment)
+{
+    uint64 Result = (Offset + Alignment - 1) & ~(Alignment - 1);
+    return(Result);
+}
+
+internal void
+WritePadding(FILE *Out, uint64 *At, uint64 Alignment)
+{
+    uint64 Aligned = AlignOffset(*At, Alignment);
+    while(*At < Aligned)
+    {
+        fputc(0, Out);
+        ++*At;
+    }
+}
+
+int
+main(int ArgCount, char **Args)
+{
+    // NOTE(casey): The order here is the order the pixels land in the file,
+    // so everything one entity draws is kept next to everything else it draws.
+    char *FileNames[] =
+    {
+        "test/test_background.bmp",
+        "test/test_hero_shadow.bmp",
+        "test2/tree00.bmp",
+        "test2/rock02.bmp",
+        "test2/rock03.bmp",
+
+        "test/test_hero_right_head.bmp",
+        "test/test_hero_right_cape.bmp",
+        "test/test_hero_right_torso.bmp",
+
+        "test/test_hero_back_head.bmp",
+        "test/test_hero_back_cape.bmp",
+        "test/test_hero_back_torso.bmp",
+
+        "test/test_hero_left_head.bmp",
+        "test/test_hero_left_cape.bmp",
+        "test/test_hero_left_torso.bmp",
+
+        "test/test_hero_front_head.bmp",
+        "test/test_hero_front_cape.bmp",
+        "test/test_hero_front_torso.bmp",
+    };
+    uint32 const BitmapCount = ArrayCount(FileNames);
+
+    char *OutFileName = (ArgCount > 1) ? Args[1] : (char *)"test.hha";
+
+    loaded_bitmap Bitmaps[BitmapCount];
+    hha_bitmap Entries[BitmapCount];
+    memset(Entries, 0, sizeof(Entries));
+
+    hha_header Header = {};
+    Header.MagicValue = HHA_MAGIC_VALUE;
+    Header.Version = HHA_VERSION;
+    Header.BitmapCount = BitmapCount;
+    Header.Bitmaps = sizeof(Header);
+
+    // NOTE(casey): Lay the file out up front, so the table of contents can
+    // be written first and everything else streamed out behind it.
+    uint64 At = Header.Bitmaps + sizeof(Entries);
+    for(uint32 BitmapIndex = 0;
+        BitmapIndex < BitmapCount;
+        ++BitmapIndex)
+    {
+        loaded_bitmap *Bitmap = Bitmaps + BitmapIndex;
+        hha_bitmap *Entry = Entries + BitmapIndex;
+
+        *Bitmap = LoadBMP(FileNames[BitmapIndex]);
+        if(!Bitmap->Pixels)
+        {
+            return(1);
+        }
+
+        Assert(strlen(FileNames[BitmapIndex]) < sizeof(Entry->Name));
+        strcpy(Entry->Name, FileNames[BitmapIndex]);
+        Entry->Width = Bitmap->Width;
+        Entry->Height = Bitmap->Height;
+        Entry->SpanCount = Bitmap->SpanCount;
+
+        At = AlignOffset(At, HHA_DATA_ALIGNMENT);
+        Entry->Pixels = At;
+        At += (uint64)Bitmap->Width*Bitmap->Height*sizeof(uint32);
+
+        Entry->RowFirstSpan = At;
+        At += ((uint64)Bitmap->Height + 1)*sizeof(uint32);
+
+        Entry->Spans = At;
+        At += (uint64)Bitmap->SpanCount*sizeof(bitmap_span);
+    }
+
+    FILE *Out = fopen(OutFileName, "wb");
+    if(!Out)
+    {
+        printf("ERROR: Couldn't open %s for writing.\n", OutFileName);
+        return(1);
+    }
+
+    fwrite(&Header, sizeof(Header), 1, Out);
+    fwrite(Entries, sizeof(Entries), 1, Out);
+    At = Header.Bitmaps + sizeof(Entries);
+    for(uint32 BitmapIndex = 0;
+        BitmapIndex < BitmapCount;
+        ++BitmapIndex)
+    {
+        loaded_bitmap *Bitmap = Bitmaps + BitmapIndex;
+        hha_bitmap *Entry = Entries + BitmapIndex;
+
+        WritePadding(Out, &At, HHA_DATA_ALIGNMENT);
+        Assert(At == Entry->Pixels);
+
+        uint32 PixelsSize = (uint32)(Bitmap->Width*Bitmap->Height*sizeof(uint32));
+        uint32 RowFirstSpanSize = (uint32)((Bitmap->Height + 1)*sizeof(uint32));
+        uint32 SpansSize = (uint32)(Bitmap->SpanCount*sizeof(bitmap_span));
+        fwrite(Bitmap->Pixels, PixelsSize, 1, Out);
+        fwrite(Bitmap->RowFirstSpan, RowFirstSpanSize, 1, Out);
+        fwrite(Bitmap->Spans, SpansSize, 1, Out);
+        At += PixelsSize + RowFirstSpanSize + SpansSize;
+    }
+    fclose(Out);
+
+    printf("Wrote %u bitmaps (%llu bytes) to %s.\n", BitmapCount, (unsigned long long)At, OutFileName);
+
+    return(0);
+}
@@ -13,7 +13,6 @@
   - Saved game locations
   - Getting a handle to our own executable file
   - Asset loading path
-  - Threading (launch a thread)
   - Raw Input (support for multiple keyboards)
   - ClipCursor() (for multimonitor support)
   - QueryCancelAutoplay
@@ -214,6 +213,113 @@ DEBUG_PLATFORM_WRITE_ENTIRE_FILE(DEBUGPlatformWriteEntireFile)
     return(Result);
 }
 
+PLATFORM_MAP_FILE(Win32MapFile)
+{
+    platform_mapped_file Result = {};
+    
+    HANDLE FileHandle = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+    if(FileHandle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER FileSize;
+        if(GetFileSizeEx(FileHandle, &FileSize))
+        {
+            HANDLE MappingHandle = CreateFileMappingA(FileHandle, 0, PAGE_READONLY, 0, 0, 0);
+            if(MappingHandle)
+            {
+                Result.Memory = MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0);
+                if(Result.Memory)
+                {
+                    Result.Size = FileSize.QuadPart;
+                }
+                else
+                {
+                    // TODO(casey): Logging
+                }
+
+                // NOTE(casey): The view keeps the mapping alive on its own,
+                // and it's never unmapped - it lives as long as the process.
+                CloseHandle(MappingHandle);
+            }
+            else
+            {
+                // TODO(casey): Logging
+            }
+        }
+
+        CloseHandle(FileHandle);
+    }
+    else
+    {
+        // TODO(casey): Logging
+    }
+
+    return(Result);
+}
+
+PLATFORM_OPEN_SCRATCH_FILE(Win32OpenScratchFile)
+{
+    platform_file_handle *Result = 0;
+
+    // NOTE(casey): Windows deletes it for us once the handle closes, which
+    // happens when the process goes away
+    HANDLE FileHandle = CreateFileA(FileName, GENERIC_READ|GENERIC_WRITE, 0, 0, CREATE_ALWAYS,
+                                    FILE_ATTRIBUTE_TEMPORARY|FILE_FLAG_DELETE_ON_CLOSE, 0);
+    if(FileHandle != INVALID_HANDLE_VALUE)
+    {
+        Result = (platform_file_handle *)FileHandle;
+    }
+    else
+    {
+        // TODO(casey): Logging
+    }
+
+    return(Result);
+}
+
+PLATFORM_READ_FROM_FILE(Win32ReadFromFile)
+{
+    bool32 Result = false;
+
+    OVERLAPPED Overlapped = {};
+    Overlapped.Offset = (DWORD)((Offset >> 0) & 0xFFFFFFFF);
+    Overlapped.OffsetHigh = (DWORD)((Offset >> 32) & 0xFFFFFFFF);
+
+    DWORD BytesRead;
+    if(ReadFile((HANDLE)Handle, Dest, Size, &BytesRead, &Overlapped) &&
+       (Size == BytesRead))
+    {
+        Result = true;
+    }
+    else
+    {
+        // TODO(casey): Logging
+    }
+
+    return(Result);
+}
+
+PLATFORM_WRITE_TO_FILE(Win32WriteToFile)
+{
+    bool32 Result = false;
+
+    OVERLAPPED Overlapped = {};
+    Overlapped.Offset = (DWORD)((Offset >> 0) & 0xFFFFFFFF);
+    Overlapped.OffsetHigh = (DWORD)((Offset >> 32) & 0xFFFFFFFF);
+
+    DWORD BytesWritten;
+    if(WriteFile((HANDLE)Handle, Source, Size, &BytesWritten, &Overlapped) &&
+       (Size == BytesWritten))
+    {
+        Result = true;
+    }
+    else
+    {
+        // TODO(casey): Logging
+    }
+
+    return(Result);
+}
+
 inline FILETIME
 Win32GetLastWriteTime(char *Filename)
 {
@@ -668,6 +774,62 @@ Win32ProcessXInputStickValue(SHORT Value, SHORT DeadZoneThreshold)
     return(Result);
 }
 
+internal void
+Win32AddEntry(platform_work_queue *Queue, platform_work_queue_callback *Callback, void *Data)
+{
+    // TODO(casey): Switch to InterlockedCompareExchange eventually
+    // so that any thread can add?
+    uint32 NewNextEntryToWrite = (Queue->NextEntryToWrite + 1) % ArrayCount(Queue->Entries);
+    Assert(NewNextEntryToWrite != Queue->NextEntryToRead);
+    platform_work_queue_entry *Entry = Queue->Entries + Queue->NextEntryToWrite;
+    Entry->Callback = Callback;
+    Entry->Data = Data;
+    ++Queue->CompletionGoal;
+    _WriteBarrier();
+    Queue->NextEntryToWrite = NewNextEntryToWrite;
+    ReleaseSemaphore(Queue->SemaphoreHandle, 1, 0);
+}
+
+internal bool32
+Win32DoNextWorkQueueEntry(platform_work_queue *Queue)
+{
+    bool32 WeShouldSleep = false;
+
+    uint32 OriginalNextEntryToRead = Queue->NextEntryToRead;
+    uint32 NewNextEntryToRead = (OriginalNextEntryToRead + 1) % ArrayCount(Queue->Entries);
+    if(OriginalNextEntryToRead != Queue->NextEntryToWrite)
+    {
+        uint32 Index = InterlockedCompareExchange((LONG volatile *)&Queue->NextEntryToRead,
+                                                  NewNextEntryToRead,
+                                                  OriginalNextEntryToRead);
+        if(Index == OriginalNextEntryToRead)
+        {
+            platform_work_queue_entry Entry = Queue->Entries[Index];
+            Entry.Callback(Queue, Entry.Data);
+            InterlockedIncrement((LONG volatile *)&Queue->CompletionCount);
+        }
+    }
+    else
+    {
+        WeShouldSleep = true;
+    }
+
+    return(WeShouldSleep);
+}
+
+internal void
+Win32CompleteAllWork(platform_work_queue *Queue)
+{
+    // NOTE(casey): The main thread pitches in instead of just waiting
+    while(Queue->CompletionGoal != Queue->CompletionCount)
+    {
+        Win32DoNextWorkQueueEntry(Queue);
+    }
+
+    Queue->CompletionGoal = 0;
+    Queue->CompletionCount = 0;
+}
+
 internal void
 Win32GetInputFileLocation(win32_state *State, bool32 InputStream,
                           int SlotIndex, int DestCount, char *Dest)
@@ -689,6 +851,10 @@ Win32GetReplayBuffer(win32_state *State, int unsigned Index)
 internal void
 Win32BeginRecordingInput(win32_state *State, int InputRecordingIndex)
 {
+    // NOTE(casey): Asset loads write into game memory, so they have to land
+    // before it gets copied
+    Win32CompleteAllWork(State->LowPriorityQueue);
+    
     win32_replay_buffer *ReplayBuffer = Win32GetReplayBuffer(State, InputRecordingIndex);
     if(ReplayBuffer->MemoryBlock)
     {
@@ -718,6 +884,10 @@ Win32EndRecordingInput(win32_state *State)
 internal void
 Win32BeginInputPlayBack(win32_state *State, int InputPlayingIndex)
 {
+    // NOTE(casey): ...and they have to land before game memory gets copied
+    // over, or they'll land on top of it afterwards
+    Win32CompleteAllWork(State->LowPriorityQueue);
+    
     win32_replay_buffer *ReplayBuffer = Win32GetReplayBuffer(State, InputPlayingIndex);
     if(ReplayBuffer->MemoryBlock)
     {
@@ -734,6 +904,7 @@ Win32BeginInputPlayBack(win32_state *State, int InputPlayingIndex)
 #endif
         
         CopyMemory(State->GameMemoryBlock, ReplayBuffer->MemoryBlock, State->TotalSize);
+        State->MemoryRestored = true;
     }
 }
 
@@ -934,6 +1105,50 @@ Win32ProcessPendingMessages(win32_state *State, game_controller_input *KeyboardC
     }
 }
 
+DWORD WINAPI
+ThreadProc(LPVOID lpParameter)
+{
+    win32_thread_info *ThreadInfo = (win32_thread_info *)lpParameter;
+
+    for(;;)
+    {
+        if(Win32DoNextWorkQueueEntry(ThreadInfo->Queue))
+        {
+            WaitForSingleObjectEx(ThreadInfo->Queue->SemaphoreHandle, INFINITE, FALSE);
+        }
+    }
+
+//    return(0);
+}
+
+internal void
+Win32MakeQueue(platform_work_queue *Queue, uint32 ThreadCount, win32_thread_info *ThreadInfo)
+{
+    Queue->CompletionGoal = 0;
+    Queue->CompletionCount = 0;
+    
+    Queue->NextEntryToWrite = 0;
+    Queue->NextEntryToRead = 0;
+
+    uint32 InitialCount = 0;
+    Queue->SemaphoreHandle = CreateSemaphoreEx(0,
+                                               InitialCount,
+                                               ThreadCount,
+                                               0, 0, SEMAPHORE_ALL_ACCESS);
+    for(uint32 ThreadIndex = 0;
+        ThreadIndex < ThreadCount;
+        ++ThreadIndex)
+    {
+        win32_thread_info *Info = ThreadInfo + ThreadIndex;
+        Info->Queue = Queue;
+        Info->LogicalThreadIndex = ThreadIndex;
+
+        DWORD ThreadID;
+        HANDLE ThreadHandle = CreateThread(0, 0, ThreadProc, Info, 0, &ThreadID);
+        CloseHandle(ThreadHandle);
+    }
+}
+
 inline LARGE_INTEGER
 Win32GetWallClock(void)
 {    
@@ -992,6 +1207,51 @@ Win32DrawSoundBufferMarker(win32_offscreen_buffer *Backbuffer,
     Win32DebugDrawVertical(Backbuffer, X, Top, Bottom, Color);
 }
 
+#if HANDMADE_INTERNAL
+internal void
+Win32HandleDebugCounters(game_memory *Memory)
+{
+    // NOTE(casey): Keep these in the same order as the DebugCounter_ enum
+    char *Names[] =
+    {
+        "EntitiesRendered",
+        "EntitiesCulled",
+        "PixelsRedrawn",
+        "ChunkLookups",
+        "ChunkProbes",
+        "ChunksPagedIn",
+        "ChunksPagedOut",
+        "ChunksReadAhead",
+    };
+    Assert(ArrayCount(Names) == DebugCounter_Count);
+
+    OutputDebugStringA("DEBUG COUNTERS:\n");
+
+    uint64 ChunkLookups = Memory->Counters[DebugCounter_ChunkLookups].Value;
+    uint64 ChunkProbes = Memory->Counters[DebugCounter_ChunkProbes].Value;
+    if(ChunkLookups)
+    {
+        char TextBuffer[256];
+        _snprintf_s(TextBuffer, sizeof(TextBuffer),
+                    "  ChunkProbesPerLookup: %.2f\n", (real64)ChunkProbes / (real64)ChunkLookups);
+        OutputDebugStringA(TextBuffer);
+    }
+
+    for(int CounterIndex = 0;
+        CounterIndex < DebugCounter_Count;
+        ++CounterIndex)
+    {
+        debug_counter *Counter = Memory->Counters + CounterIndex;
+
+        char TextBuffer[256];
+        _snprintf_s(TextBuffer, sizeof(TextBuffer),
+                    "  %s: %I64u\n", Names[CounterIndex], Counter->Value);
+        OutputDebugStringA(TextBuffer);
+        Counter->Value = 0;
+    }
+}
+#endif
+
 internal void
 Win32DebugSyncDisplay(win32_offscreen_buffer *Backbuffer,
                       int MarkerCount, win32_debug_time_marker *Markers,
@@ -1067,6 +1327,30 @@ WinMain(HINSTANCE Instance,
 
     Win32GetEXEFileName(&Win32State);
 
+    // NOTE(casey): One worker per logical core, minus the main thread,
+    // which helps out whenever it waits on the queue.
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+    win32_thread_info HighPriorityThreads[63];
+    uint32 HighPriorityThreadCount = SystemInfo.dwNumberOfProcessors - 1;
+    if(HighPriorityThreadCount < 1)
+    {
+        HighPriorityThreadCount = 1;
+    }
+    if(HighPriorityThreadCount > ArrayCount(HighPriorityThreads))
+    {
+        HighPriorityThreadCount = ArrayCount(HighPriorityThreads);
+    }
+    platform_work_queue HighPriorityQueue = {};
+    Win32MakeQueue(&HighPriorityQueue, HighPriorityThreadCount, HighPriorityThreads);
+
+    // NOTE(casey): Asset loads go on their own queue, so a slow load can
+    // never hold up the frame's rendering work.
+    win32_thread_info LowPriorityThreads[2];
+    platform_work_queue LowPriorityQueue = {};
+    Win32MakeQueue(&LowPriorityQueue, ArrayCount(LowPriorityThreads), LowPriorityThreads);
+    Win32State.LowPriorityQueue = &LowPriorityQueue;
+
     char SourceGameCodeDLLFullPath[WIN32_STATE_FILE_NAME_COUNT];
     Win32BuildEXEPathFileName(&Win32State, "handmade.dll",
                               sizeof(SourceGameCodeDLLFullPath), SourceGameCodeDLLFullPath);
@@ -1183,6 +1467,14 @@ WinMain(HINSTANCE Instance,
             GameMemory.DEBUGPlatformFreeFileMemory = DEBUGPlatformFreeFileMemory;
             GameMemory.DEBUGPlatformReadEntireFile = DEBUGPlatformReadEntireFile;
             GameMemory.DEBUGPlatformWriteEntireFile = DEBUGPlatformWriteEntireFile;
+            GameMemory.HighPriorityQueue = &HighPriorityQueue;
+            GameMemory.LowPriorityQueue = &LowPriorityQueue;
+            GameMemory.PlatformAddEntry = Win32AddEntry;
+            GameMemory.PlatformCompleteAllWork = Win32CompleteAllWork;
+            GameMemory.PlatformMapFile = Win32MapFile;
+            GameMemory.PlatformOpenScratchFile = Win32OpenScratchFile;
+            GameMemory.PlatformReadFromFile = Win32ReadFromFile;
+            GameMemory.PlatformWriteToFile = Win32WriteToFile;
 
 
             // TODO(casey): Handle various memory footprints (USING
@@ -1265,10 +1557,14 @@ WinMain(HINSTANCE Instance,
                     FILETIME NewDLLWriteTime = Win32GetLastWriteTime(SourceGameCodeDLLFullPath);
                     if(CompareFileTime(&NewDLLWriteTime, &Game.DLLLastWriteTime) != 0)
                     {
+                        // NOTE(casey): Queued asset loads call back into the
+                        // game code, so they have to finish before it goes away
+                        Win32CompleteAllWork(&LowPriorityQueue);
                         Win32UnloadGameCode(&Game);
                         Game = Win32LoadGameCode(SourceGameCodeDLLFullPath,
                                                  TempGameCodeDLLFullPath,
                                                  GameCodeLockFullPath);
+                        GameMemory.ExecutableReloaded = true;
                         LoadCounter = 0;
                     }
 
@@ -1441,9 +1737,17 @@ WinMain(HINSTANCE Instance,
                         {
                             Win32PlayBackInput(&Win32State, NewInput);
                         }
+                        GameMemory.MemoryMayBeRestored = (Win32State.InputRecordingIndex ||
+                                                          Win32State.InputPlayingIndex);
+                        GameMemory.MemoryRestored = Win32State.MemoryRestored;
+                        Win32State.MemoryRestored = false;
                         if(Game.UpdateAndRender)
                         {
                             Game.UpdateAndRender(&Thread, &GameMemory, NewInput, &Buffer);
+                            GameMemory.ExecutableReloaded = false;
+#if HANDMADE_INTERNAL
+                            Win32HandleDebugCounters(&GameMemory);
+#endif
                         }
 
                         LARGE_INTEGER AudioWallClock = Win32GetWallClock();
@@ -80,10 +80,38 @@ struct win32_state
 
     HANDLE PlaybackHandle;
     int InputPlayingIndex;
+    bool32 MemoryRestored;
+
+    // NOTE(casey): Drained before game memory is copied in either direction
+    platform_work_queue *LowPriorityQueue;
     
     char EXEFileName[WIN32_STATE_FILE_NAME_COUNT];
     char *OnePastLastEXEFileNameSlash;
 };
 
+struct platform_work_queue_entry
+{
+    platform_work_queue_callback *Callback;
+    void *Data;
+};
+
+struct platform_work_queue
+{
+    uint32 volatile CompletionGoal;
+    uint32 volatile CompletionCount;
+    
+    uint32 volatile NextEntryToWrite;
+    uint32 volatile NextEntryToRead;
+    HANDLE SemaphoreHandle;
+
+    platform_work_queue_entry Entries[256];
+};
+
+struct win32_thread_info
+{
+    int LogicalThreadIndex;
+    platform_work_queue *Queue;
+};
+
 #define WIN32_HANDMADE_H
 #endif